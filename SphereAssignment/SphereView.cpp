@@ -0,0 +1,101 @@
+#pragma once
+#include "SphereView.h"
+#include <algorithm>
+
+//Far past the far clip from anywhere the camera can reach, so parked models are never drawn
+const float PARKED_Z = 10000000.0f;
+
+CModelPool::CModelPool(tle::IMesh* mesh, const char* skin, int size) {
+	models.reserve(size);
+	for (int i = 0; i < size; i++) {
+		tle::IModel* model = mesh->CreateModel(0.0f, 0.0f, PARKED_Z);
+		model->SetSkin(skin);
+		models.emplace_back(model);
+	}
+}
+
+void CModelPool::Begin() {
+	lastBound = numBound;
+	numBound = 0;
+}
+
+bool CModelPool::Bind(const CircleUpdateData* sphere) {
+	if (numBound == int(models.size())) return false;
+	models.at(numBound)->SetPosition(sphere->pos.x, sphere->pos.y, 0.0f);
+	numBound++;
+	return true;
+}
+
+void CModelPool::End() {
+	//Models past lastBound were already parked
+	for (int i = numBound; i < lastBound; i++) models.at(i)->SetPosition(0.0f, 0.0f, PARKED_Z);
+}
+
+CSphereView::CSphereView(const CSimulation& Simulation, tle::IMesh* sphereMesh, int poolSize) :
+	simulation(Simulation),
+	staticPool(sphereMesh, "Baize.jpg", poolSize),
+	dynamicPool(sphereMesh, "RedBall.jpg", poolSize) {
+
+	//Sphere data never moves in memory in a single process run, so the lookups stay valid
+	for (auto sphere : simulation.Statics()) {
+		if (sphere->id >= int(staticById.size())) staticById.resize(sphere->id + 1, nullptr);
+		staticById.at(sphere->id) = sphere;
+	}
+	for (auto sphere : simulation.Dynamics()) {
+		if (sphere->id >= int(dynamicById.size())) dynamicById.resize(sphere->id + 1, nullptr);
+		dynamicById.at(sphere->id) = sphere;
+	}
+	hits.reserve(poolSize * 2);
+	visibleStatics.reserve(poolSize);
+	visibleDynamics.reserve(poolSize);
+}
+
+void CSphereView::Update(tle::ICamera* camera, float aspect) {
+	//Rows of the camera's world matrix are its right, up and forward axes then its position
+	float matrix[16];
+	camera->GetMatrix(matrix);
+	const CFrustum frustum({ matrix[12], matrix[13], matrix[14] }, { matrix[0], matrix[1], matrix[2] }, { matrix[4], matrix[5], matrix[6] }, { matrix[8], matrix[9], matrix[10] },
+		CAMERA_FIELD_OF_VIEW, aspect, CAMERA_NEAR_CLIP, CAMERA_FAR_CLIP);
+
+	visibleStatics.clear();
+	visibleDynamics.clear();
+
+	//The snapshot is from the start of the last step, the margin covers the largest sphere plus how far it could have moved since
+	const float margin = simulation.Config().StripMargin();
+	bFootprint = frustum.PlaneFootprint(margin, footprintMin, footprintMax);
+	auto snapshot = simulation.Queries().Snapshot();
+	if (snapshot && bFootprint) {
+		hits.clear();
+		snapshot->QueryRect(footprintMin, footprintMax, hits);
+
+		const vector3 eye = frustum.Position();
+		for (const auto& hit : hits) {
+			//Culled and drawn where the live sphere is rather than where the snapshot saw it
+			const CircleUpdateData* sphere = hit.bDynamic ? dynamicById.at(hit.id) : staticById.at(hit.id);
+			const vector3 centre = { sphere->pos.x, sphere->pos.y, 0.0f };
+			if (!frustum.Intersects(centre, sphere->radius)) continue;
+			(hit.bDynamic ? visibleDynamics : visibleStatics).emplace_back(LengthSq(centre - eye), sphere);
+		}
+	}
+	numVisible = int(visibleStatics.size() + visibleDynamics.size());
+
+	staticPool.Begin();
+	dynamicPool.Begin();
+	BindNearest(visibleStatics, staticPool);
+	BindNearest(visibleDynamics, dynamicPool);
+	staticPool.End();
+	dynamicPool.End();
+}
+
+void CSphereView::BindNearest(VisibleList& visible, CModelPool& pool) {
+	//Only the nearest need to be picked out, their order among themselves doesn't matter
+	if (int(visible.size()) > pool.Size()) {
+		std::nth_element(visible.begin(), visible.begin() + pool.Size(), visible.end(), [](const std::pair<float, const CircleUpdateData*>& a, const std::pair<float, const CircleUpdateData*>& b)
+			{
+				return a.first < b.first;
+			});
+	}
+	for (const auto& sphere : visible) {
+		if (!pool.Bind(sphere.second)) break;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <TL-Engine.h>	// TL-Engine include file and namespace
+#include "Simulation.h"
+#include "Frustum.h"
+#include <vector>
+#include <utility>
+
+//Camera settings the view culls with, set on the engine's camera too so the two agree
+const float CAMERA_FIELD_OF_VIEW = 3.14159265f / 3.0f;
+const float CAMERA_NEAR_CLIP = 1.0f;
+const float CAMERA_FAR_CLIP = 30000.0f;
+
+//Fixed set of models made once up front and handed to whichever spheres are on screen each frame.
+class CModelPool
+{
+public:
+	CModelPool(tle::IMesh* mesh, const char* skin, int size);
+	//Frees every model for the frame's binding
+	void Begin();
+	//Moves the next free model onto the sphere, false once every model is in use
+	bool Bind(const CircleUpdateData* sphere);
+	//Parks the models bound last frame that weren't needed this frame
+	void End();
+
+	int Size() const { return int(models.size()); }
+	int Bound() const { return numBound; }
+
+private:
+	std::vector<tle::IModel*> models;
+	int numBound = 0;
+	int lastBound = 0;
+};
+
+//Draws a simulation through a limited number of pooled models.
+//Each frame the camera's frustum becomes a rect query against the simulation's spatial index, the hits are tested against
+//the frustum and models are bound to the survivors, nearest first when there are more than a pool holds.
+//Spheres off screen have no model so drawing and syncing positions costs what's on screen rather than the sphere count.
+class CSphereView
+{
+public:
+	CSphereView(const CSimulation& simulation, tle::IMesh* sphereMesh, int poolSize);
+	CSphereView(const CSphereView&) = delete;
+	CSphereView& operator=(const CSphereView&) = delete;
+
+	//Call after each Step so the models land where the spheres ended the frame
+	void Update(tle::ICamera* camera, float aspect);
+
+	//Where the camera's view crosses the sphere plane as of the last Update, false if it doesn't
+	bool Footprint(vector2& min, vector2& max) const {
+		min = footprintMin;
+		max = footprintMax;
+		return bFootprint;
+	}
+	int NumVisible() const { return numVisible; }
+	int NumDrawn() const { return staticPool.Bound() + dynamicPool.Bound(); }
+
+private:
+	typedef std::vector<std::pair<float, const CircleUpdateData*>> VisibleList;
+
+	void BindNearest(VisibleList& visible, CModelPool& pool);
+
+	const CSimulation& simulation;
+	CModelPool staticPool;
+	CModelPool dynamicPool;
+	//Query hits carry ids, these find the live sphere behind each
+	std::vector<const CircleUpdateData*> staticById;
+	std::vector<const CircleUpdateData*> dynamicById;
+
+	//Reused every frame
+	std::vector<SphereHit> hits;
+	VisibleList visibleStatics;
+	VisibleList visibleDynamics;
+	int numVisible = 0;
+	bool bFootprint = false;
+	vector2 footprintMin = { 0.0f, 0.0f };
+	vector2 footprintMax = { 0.0f, 0.0f };
+};
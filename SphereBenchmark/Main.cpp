@@ -0,0 +1,370 @@
+#pragma once
+#include "Simulation.h"
+#include "Collision.h"
+#include "FrameBarrier.h"
+#include "Verify.h"
+#include "Ensemble.h"
+#include "Replay.h"
+#include "Scaling.h"
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <iomanip>
+#include <cmath>
+#include <sstream>
+
+//Runs the simulation core headless and reports how fast it steps.
+//	SphereBenchmark [--frames N] [--spheres N] [--workers N] [--seed N] [--jacobi] [--fixed] [--lod] [--search] [--graph] [--perf] [--storage fixed32|fixed16]
+//		[--world HALFSIZE] [--open] [--clusters N] [--clusterradius R] [--chunk SIZE] [--broadphase sweep|grid] [--radii MIN,MAX]
+//		[--dimensions 2|3] [--depth HALFSIZE] [--slabs N]
+//																						time whole frames, --perf adds hardware counters per phase and worker, --radii draws log-uniform radii,
+//																						--slabs splits the world between N processes that each report their own slab
+//	SphereBenchmark --kernels																time the specialised kernel against the generic one
+//	SphereBenchmark --barrier																time the frame barrier against condition variables
+//	SphereBenchmark --ensemble N [--frames N] [--spheres N] [--workers N] [--seed N]		run N independent worlds on one pool and report total throughput
+//	SphereBenchmark --replay PATH [--frames N] [--spheres N] [--workers N] [--seed N]		record to PATH, then time playing it back
+//	SphereBenchmark --scaling [--threads N,N..] [--sizes N,N..] [--densities F,F..] [--csv PATH] [--frames N]	strong and weak scaling tables
+//	SphereBenchmark --broadphases [--frames N] [--spheres N] [--workers N] [--seed N]		time the sweep against the hierarchical grid as the radius range widens
+//	SphereBenchmark --dimensions-compare [--sizes N,N..] [--frames N] [--workers N] [--seed N]	time 2-D worlds against 3-D ones of the same sphere counts
+//	SphereBenchmark --verify [--trials N] [--frames N] [--seed N]							check every collision path against the brute force reference
+
+void BenchmarkFrames(const SimulationConfig& config, int numFrames);
+void BenchmarkKernels(const SimulationConfig& config, int numFrames);
+void BenchmarkEnsemble(const SimulationConfig& config, int numWorlds, int numFrames);
+void BenchmarkReplay(const SimulationConfig& config, int numFrames, const std::string& path);
+void BenchmarkBroadphases(const SimulationConfig& config, int numFrames);
+void BenchmarkDimensions(const SimulationConfig& config, const std::vector<int>& sphereCounts, int numFrames);
+
+//Comma separated values, such as 1,2,4
+template <typename T>
+std::vector<T> ParseList(const std::string& text) {
+	std::vector<T> values;
+	size_t start = 0;
+	while (start < text.size()) {
+		size_t end = text.find(',', start);
+		if (end == std::string::npos) end = text.size();
+		values.emplace_back(T(std::stod(text.substr(start, end - start))));
+		start = end + 1;
+	}
+	return values;
+}
+
+int main(int argc, char** argv) {
+	SimulationConfig config;
+	config.checkAllocations = false;
+	config.publishQueries = false;
+	config.seed = 1;
+	int numFrames = -1;
+	int numTrials = 20;
+	bool bKernels = false;
+	bool bBarrier = false;
+	bool bVerify = false;
+	int numWorlds = 0;
+	std::string replayPath;
+	bool bScaling = false;
+	bool bBroadphases = false;
+	bool bDimensions = false;
+	std::vector<int> dimensionSizes = { 10000, 100000, 1000000 };
+	ScalingMatrix scalingMatrix = DefaultScalingMatrix();
+	std::string csvPath;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool bHasValue = i + 1 < argc;
+		if (arg == "--frames" && bHasValue) numFrames = std::stoi(argv[++i]);
+		else if (arg == "--spheres" && bHasValue) config.circleAmount = std::stoi(argv[++i]);
+		else if (arg == "--workers" && bHasValue) config.numWorkers = std::stoi(argv[++i]);
+		else if (arg == "--seed" && bHasValue) config.seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+		else if (arg == "--jacobi") config.jacobiResolution = true;
+		else if (arg == "--fixed") config.adaptiveScheduling = false;
+		else if (arg == "--lod") config.lodScheduling = true;
+		else if (arg == "--search") config.coherentSweep = false;
+		else if (arg == "--graph") config.taskGraph = true;
+		else if (arg == "--perf") config.perfCounters = true;
+		else if (arg == "--storage" && bHasValue) {
+			const std::string storage = argv[++i];
+			if (storage == "fixed32") config.positionStorage = EPositionStorage::Fixed32;
+			else if (storage == "fixed16") config.positionStorage = EPositionStorage::Fixed16;
+			else config.positionStorage = EPositionStorage::Float;
+		}
+		else if (arg == "--world" && bHasValue) {
+			const float halfSize = std::stof(argv[++i]);
+			config.xMinCoord = -halfSize;
+			config.xMaxCoord = halfSize;
+			config.yMinCoord = -halfSize;
+			config.yMaxCoord = halfSize;
+		}
+		else if (arg == "--open") config.bounds = EBounds::Open;
+		else if (arg == "--clusters" && bHasValue) config.numClusters = std::stoi(argv[++i]);
+		else if (arg == "--clusterradius" && bHasValue) config.clusterRadius = std::stof(argv[++i]);
+		else if (arg == "--slabs" && bHasValue) config.numSlabs = std::stoi(argv[++i]);
+		else if (arg == "--chunk" && bHasValue) config.chunkSize = std::stof(argv[++i]);
+		else if (arg == "--broadphase" && bHasValue) config.broadphase = std::string(argv[++i]) == "grid" ? EBroadphase::HierarchicalGrid : EBroadphase::Sweep;
+		else if (arg == "--radii" && bHasValue) {
+			const std::vector<float> radii = ParseList<float>(argv[++i]);
+			if (radii.size() != 2 || radii.at(0) <= 0.0f || radii.at(1) < radii.at(0)) {
+				std::cout << "--radii takes the smallest and largest radius, such as 1,100\n";
+				return 1;
+			}
+			config.sphereRadius = (radii.at(0) + radii.at(1)) * 0.5f;
+			config.sphereRadiusVariation = (radii.at(1) - radii.at(0)) * 0.5f;
+			config.bLogUniformRadius = true;
+		}
+		else if (arg == "--dimensions" && bHasValue) config.dimensions = std::stoi(argv[++i]);
+		else if (arg == "--depth" && bHasValue) {
+			const float halfSize = std::stof(argv[++i]);
+			config.zMinCoord = -halfSize;
+			config.zMaxCoord = halfSize;
+		}
+		else if (arg == "--broadphases") bBroadphases = true;
+		else if (arg == "--dimensions-compare") bDimensions = true;
+		else if (arg == "--kernels") bKernels = true;
+		else if (arg == "--barrier") bBarrier = true;
+		else if (arg == "--verify") bVerify = true;
+		else if (arg == "--ensemble" && bHasValue) numWorlds = std::stoi(argv[++i]);
+		else if (arg == "--replay" && bHasValue) replayPath = argv[++i];
+		else if (arg == "--scaling") bScaling = true;
+		else if (arg == "--threads" && bHasValue) scalingMatrix.threadCounts = ParseList<int>(argv[++i]);
+		else if (arg == "--sizes" && bHasValue) {
+			scalingMatrix.sphereCounts = ParseList<int>(argv[++i]);
+			dimensionSizes = scalingMatrix.sphereCounts;
+		}
+		else if (arg == "--densities" && bHasValue) scalingMatrix.densities = ParseList<float>(argv[++i]);
+		else if (arg == "--csv" && bHasValue) csvPath = argv[++i];
+		else if (arg == "--trials" && bHasValue) numTrials = std::stoi(argv[++i]);
+		else {
+			std::cout << "Unknown argument " << arg << "\n";
+			return 1;
+		}
+	}
+
+	//The scaling suite picks frames per world size unless told
+	scalingMatrix.numFrames = numFrames;
+	//Verifying runs the O(n^2) reference every frame so defaults to far fewer frames
+	if (numFrames < 0) numFrames = bVerify || bBroadphases || bDimensions ? 30 : 200;
+
+	if (bVerify) return VerifyAgainstReference(config.seed, numTrials, numFrames) == 0 ? 0 : 1;
+	if (bBarrier) {
+		int benchmarkWorkers = NumCores() - 1;
+		if (benchmarkWorkers < 1) benchmarkWorkers = 1;
+		BenchmarkFrameBarrier(benchmarkWorkers, 10000);
+	}
+	else if (numWorlds > 0) BenchmarkEnsemble(config, numWorlds, numFrames);
+	else if (bScaling) RunScalingSuite(config, scalingMatrix, csvPath);
+	else if (bBroadphases) BenchmarkBroadphases(config, numFrames);
+	else if (bDimensions) BenchmarkDimensions(config, dimensionSizes, numFrames);
+	else if (!replayPath.empty()) BenchmarkReplay(config, numFrames, replayPath);
+	else if (bKernels) BenchmarkKernels(config, numFrames);
+	else BenchmarkFrames(config, numFrames);
+	return 0;
+}
+
+void BenchmarkFrames(const SimulationConfig& config, int numFrames) {
+	CSimulation simulation(config);
+	simulation.Start();
+
+	std::vector<double> frameTimes;
+	frameTimes.reserve(numFrames);
+	for (int frame = 0; frame < numFrames; frame++) {
+		auto start = std::chrono::steady_clock::now();
+		simulation.Step(1.0f / 60.0f);
+		frameTimes.emplace_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	double total = 0.0;
+	for (double time : frameTimes) total += time;
+	std::sort(frameTimes.begin(), frameTimes.end());
+	const double mean = total / numFrames;
+	//Each slab writes its results in one go so they aren't interleaved with another's
+	std::ostringstream out;
+	if (simulation.NumRanks() > 1) out << "Slab " << simulation.Rank() << " of " << simulation.NumRanks() << ", " << simulation.Dynamics().size() << " dynamics\n";
+	out << "Spheres " << config.circleAmount << ", workers " << simulation.NumWorkers() << ", frames " << numFrames << "\n";
+	out << "Mean " << mean << "ms, median " << frameTimes.at(numFrames / 2) << "ms, worst " << frameTimes.back() << "ms per frame\n";
+	out << double(simulation.NumRanks() > 1 ? simulation.Dynamics().size() : config.circleAmount - config.circleAmount / 2) / (mean / 1000.0) << " dynamic sphere steps per second\n";
+	simulation.Report(out);
+	std::cout << out.str() << std::flush;
+}
+
+//Runs the same world through the selected kernel and the generic one on the main thread and prints the time per frame.
+void BenchmarkKernels(const SimulationConfig& config, int numFrames) {
+	SimulationConfig worldConfig = config;
+	worldConfig.numWorkers = 0;
+	CSimulation simulation(worldConfig);
+	simulation.Start();
+
+	const ThreadUpdateFunction kernels[2] = { SelectKernel(config, simulation.Statics(), simulation.Dynamics()), GenericKernel() };
+	const char* names[2] = { "Specialised", "Generic" };
+	CFrameArena arena;
+
+	for (int k = 0; k < 2; k++) {
+		//Each kernel gets a fresh copy of the starting world
+		std::vector<CircleUpdateData> staticCopy;
+		std::vector<CircleUpdateData> dynamicCopy;
+		for (auto sphere : simulation.Statics()) staticCopy.emplace_back(*sphere);
+		for (auto sphere : simulation.Dynamics()) dynamicCopy.emplace_back(*sphere);
+		std::vector<CircleUpdateData*> statics;
+		std::vector<CircleUpdateData*> dynamics;
+		for (auto& sphere : staticCopy) statics.emplace_back(&sphere);
+		for (auto& sphere : dynamicCopy) dynamics.emplace_back(&sphere);
+
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < numFrames; frame++) {
+			arena.Reset();
+			std::sort(dynamics.begin(), dynamics.end(), SortCondition);
+			kernels[k](config, statics, dynamics, 0, int(dynamics.size()), 1.0f, arena);
+		}
+		auto end = std::chrono::steady_clock::now();
+		std::cout << names[k] << " kernel: " << std::chrono::duration<double, std::milli>(end - start).count() / numFrames << "ms per frame\n";
+	}
+}
+
+//A small sweep: world i is seeded seed + i, has a quarter to all of --spheres and one to three times the velocity limit.
+//--workers counts threads beyond the main one as it does for a single world.
+void BenchmarkEnsemble(const SimulationConfig& config, int numWorlds, int numFrames) {
+	CEnsemble ensemble(config.numWorkers < 0 ? -1 : config.numWorkers + 1);
+	for (int i = 0; i < numWorlds; i++) {
+		SimulationConfig worldConfig = config;
+		worldConfig.seed = config.seed + i;
+		worldConfig.circleAmount = config.circleAmount * (i % 4 + 1) / 4;
+		const float velocityScale = float(i % 3 + 1);
+		worldConfig.xVelocityPosLimit *= velocityScale;
+		worldConfig.xVelocityNegLimit *= velocityScale;
+		worldConfig.yVelocityPosLimit *= velocityScale;
+		worldConfig.yVelocityNegLimit *= velocityScale;
+		ensemble.Add(worldConfig, numFrames);
+	}
+	ensemble.Run();
+	ensemble.Report(std::cout);
+}
+
+//Times the same run without and with recording, then plays the recording back straight through and by seeking to random
+//frames. The last frame played back should be within a position step and half a velocity step of where the simulation ended.
+void BenchmarkReplay(const SimulationConfig& config, int numFrames, const std::string& path) {
+	double frameTimes[2] = { 0.0, 0.0 };
+	std::vector<CircleUpdateData> finalDynamics;
+	for (int record = 0; record < 2; record++) {
+		SimulationConfig runConfig = config;
+		if (record == 1) runConfig.replayPath = path;
+		CSimulation simulation(runConfig);
+		simulation.Start();
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < numFrames; frame++) simulation.Step(1.0f / 60.0f);
+		frameTimes[record] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / numFrames;
+		if (record == 1) for (auto sphere : simulation.Dynamics()) finalDynamics.emplace_back(*sphere);
+	}
+	std::cout << "Stepping " << frameTimes[0] << "ms per frame, recording " << frameTimes[1] << "ms per frame, " << (frameTimes[1] / frameTimes[0] - 1.0) * 100.0 << "% overhead\n";
+
+	CReplayPlayer* player = CReplayPlayer::Open(path.c_str());
+	if (player == nullptr) {
+		std::cout << "Couldn't read back " << path << "\n";
+		return;
+	}
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	const double fileBytes = double(file.tellg());
+	const int numDynamics = int(player->Dynamics().size());
+	std::cout << player->NumFrames() << " frames in " << fileBytes / (1024.0 * 1024.0) << "MB, " << fileBytes / player->NumFrames() / numDynamics << " bytes per dynamic per frame\n";
+
+	auto start = std::chrono::steady_clock::now();
+	int played = 0;
+	while (player->Next()) played++;
+	const double playTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / played;
+	std::cout << "Played back at " << playTime << "ms per frame, " << (1000.0 / 60.0) / playTime << "x real time\n";
+
+	float positionError = 0.0f;
+	float velocityError = 0.0f;
+	for (auto& sphere : finalDynamics) {
+		const CircleUpdateData& played = player->Dynamics().at(sphere.id);
+		positionError = std::max(positionError, std::max(std::abs(played.pos.x - sphere.pos.x), std::abs(played.pos.y - sphere.pos.y)));
+		velocityError = std::max(velocityError, std::max(std::abs(played.velocity.x - sphere.velocity.x), std::abs(played.velocity.y - sphere.velocity.y)));
+	}
+	std::cout << "Last frame off by at most " << positionError << " in position and " << velocityError << " in velocity\n";
+
+	const int numSeeks = 100;
+	std::default_random_engine gen(config.seed);
+	std::uniform_int_distribution<> frameDistribution(0, player->NumFrames() - 1);
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numSeeks; i++) player->Seek(frameDistribution(gen));
+	std::cout << "Random seeks took " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / numSeeks << "ms each\n";
+	delete player;
+}
+
+//Steps worlds of log-uniform radii from 1 up to each largest radius, all covering the same fraction of the world, with the
+//sweep and then the hierarchical grid. The sweep scans as far across as the largest radius reaches, which widens with the
+//world as spheres are added, while the grid searches a few cells on each of its levels. Grid times leave out its build, shown apart.
+void BenchmarkBroadphases(const SimulationConfig& config, int numFrames) {
+	const float largestRadii[] = { 1.0f, 10.0f, 100.0f, 1000.0f };
+	const float coverage = 0.2f;
+	std::cout << "Log-uniform radii, " << config.circleAmount << " spheres covering " << coverage << " of the world, " << numFrames << " frames\n";
+	std::cout << "    radii    sweep ms     grid ms   speedup  levels   cells  build ms\n";
+
+	for (float largest : largestRadii) {
+		SimulationConfig worldConfig = config;
+		worldConfig.sphereRadius = (1.0f + largest) * 0.5f;
+		worldConfig.sphereRadiusVariation = (largest - 1.0f) * 0.5f;
+		worldConfig.bLogUniformRadius = true;
+		//Mean area of a log-uniform radius, the world is sized so the spheres cover the same fraction at every range
+		const float meanRadiusSq = largest > 1.0f ? (largest * largest - 1.0f) / (2.0f * std::log(largest)) : 1.0f;
+		const float halfSize = 0.5f * std::sqrt(config.circleAmount * 3.14159265f * meanRadiusSq / coverage);
+		worldConfig.xMinCoord = -halfSize;
+		worldConfig.xMaxCoord = halfSize;
+		worldConfig.yMinCoord = -halfSize;
+		worldConfig.yMaxCoord = halfSize;
+
+		double frameTimes[2] = {};
+		double buildTime = 0.0;
+		int levels = 0;
+		int cells = 0;
+		for (int b = 0; b < 2; b++) {
+			worldConfig.broadphase = b == 0 ? EBroadphase::Sweep : EBroadphase::HierarchicalGrid;
+			CSimulation simulation(worldConfig);
+			auto start = std::chrono::steady_clock::now();
+			simulation.Start();
+			if (b == 1) {
+				buildTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				levels = simulation.Grid()->NumLevels();
+				cells = simulation.Grid()->NumCells();
+			}
+			start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < numFrames; frame++) simulation.Step(1.0f / 60.0f);
+			frameTimes[b] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / numFrames;
+		}
+		std::cout << std::setw(5) << "1-" << std::setw(4) << largest << std::setw(12) << frameTimes[0] << std::setw(12) << frameTimes[1] << std::setw(10) << frameTimes[0] / frameTimes[1]
+			<< std::setw(8) << levels << std::setw(8) << cells << std::setw(10) << buildTime << "\n";
+	}
+}
+
+//Steps each sphere count as a 2-D world and then a 3-D one, the square and the cube sized so the spheres cover the same
+//fraction of each. Times leave out Start, which bins the 3-D world's statics.
+void BenchmarkDimensions(const SimulationConfig& config, const std::vector<int>& sphereCounts, int numFrames) {
+	const float coverage = 0.2f;
+	const float radius = config.sphereRadius;
+	std::cout << "Radius " << radius << ", spheres covering " << coverage << " of the area or volume, " << numFrames << " frames\n";
+	std::cout << "  spheres     2-D ms     3-D ms   2-D steps/s   3-D steps/s\n";
+
+	for (int count : sphereCounts) {
+		SimulationConfig worldConfig = config;
+		worldConfig.circleAmount = count;
+		worldConfig.sphereRadiusVariation = 0.0f;
+		worldConfig.bLogUniformRadius = false;
+		double frameTimes[2] = {};
+		for (int d = 0; d < 2; d++) {
+			worldConfig.dimensions = d == 0 ? 2 : 3;
+			const float halfSize = d == 0 ? 0.5f * std::sqrt(count * 3.14159265f * radius * radius / coverage)
+				: 0.5f * std::cbrt(count * 4.0f / 3.0f * 3.14159265f * radius * radius * radius / coverage);
+			worldConfig.xMinCoord = worldConfig.yMinCoord = worldConfig.zMinCoord = -halfSize;
+			worldConfig.xMaxCoord = worldConfig.yMaxCoord = worldConfig.zMaxCoord = halfSize;
+
+			CSimulation simulation(worldConfig);
+			simulation.Start();
+			const auto start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < numFrames; frame++) simulation.Step(1.0f / 60.0f);
+			frameTimes[d] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / numFrames;
+		}
+		const int numDynamics = count - count / 2;
+		std::cout << std::setw(9) << count << std::setw(11) << frameTimes[0] << std::setw(11) << frameTimes[1]
+			<< std::setw(14) << numDynamics / (frameTimes[0] / 1000.0) << std::setw(14) << numDynamics / (frameTimes[1] / 1000.0) << "\n";
+	}
+}
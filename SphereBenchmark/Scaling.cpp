@@ -0,0 +1,166 @@
+#pragma once
+#include "Scaling.h"
+#include "Simulation.h"
+#include "Affinity.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+//Untimed frames before each run, the first sorts the dynamics from scratch and grows every arena
+const int SCALING_WARMUP_FRAMES = 2;
+//Dynamic and static spheres stepped per run when the matrix leaves the frames to the suite, within these frame limits
+const double SCALING_SPHERES_PER_RUN = 2e7;
+const int SCALING_MIN_FRAMES = 5;
+const int SCALING_MAX_FRAMES = 200;
+const int SCALING_BAR_WIDTH = 20;
+
+//Mean times of one run in milliseconds per frame
+struct ScalingRun {
+	int threads = 1;
+	int spheres = 0;
+	float density = 0.0f;
+	int frames = 0;
+	double frameTime = 0.0;
+	double sortTime = 0.0;
+	double collideTime = 0.0;
+};
+
+ScalingMatrix DefaultScalingMatrix() {
+	ScalingMatrix matrix;
+	const int numCores = NumCores();
+	for (int threads = 1; threads < numCores; threads *= 2) matrix.threadCounts.emplace_back(threads);
+	matrix.threadCounts.emplace_back(numCores);
+	matrix.sphereCounts = { 1000, 10000, 100000, 1000000, 10000000 };
+	matrix.densities = { 0.1f, 0.3f };
+	return matrix;
+}
+
+static ScalingRun TimeRun(const SimulationConfig& config, int threads, int spheres, float density, int numFrames) {
+	SimulationConfig runConfig = config;
+	runConfig.numWorkers = threads - 1;
+	runConfig.adaptiveScheduling = false;
+	runConfig.circleAmount = spheres;
+	//A square world centred on the origin, statics and dynamics both count towards the density
+	const float sphereArea = 3.14159265f * config.sphereRadius * config.sphereRadius;
+	const float halfSide = 0.5f * std::sqrt(float(spheres) * sphereArea / density);
+	runConfig.xMinCoord = -halfSide;
+	runConfig.xMaxCoord = halfSide;
+	runConfig.yMinCoord = -halfSide;
+	runConfig.yMaxCoord = halfSide;
+
+	ScalingRun run;
+	run.threads = threads;
+	run.spheres = spheres;
+	run.density = density;
+	run.frames = numFrames;
+	if (run.frames < 0) run.frames = std::clamp(int(SCALING_SPHERES_PER_RUN / spheres), SCALING_MIN_FRAMES, SCALING_MAX_FRAMES);
+
+	CSimulation simulation(runConfig);
+	simulation.Start();
+	for (int frame = 0; frame < SCALING_WARMUP_FRAMES; frame++) simulation.Step(1.0f / 60.0f);
+	for (int frame = 0; frame < run.frames; frame++) {
+		auto start = std::chrono::steady_clock::now();
+		simulation.Step(1.0f / 60.0f);
+		run.frameTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		run.sortTime += simulation.PhaseTime(CSimulation::SortPhase) * 1000.0;
+		run.collideTime += simulation.PhaseTime(CSimulation::CollidePhase) * 1000.0;
+	}
+	run.frameTime /= run.frames;
+	run.sortTime /= run.frames;
+	run.collideTime /= run.frames;
+	return run;
+}
+
+//Runs are in thread order and measured against the first. Strong scaling runs share a world so speedup is how much faster
+//each is, weak scaling runs grow the world with the threads so efficiency is how close each stays to the first one's time.
+static void WriteTable(const char* kind, const std::vector<ScalingRun>& runs, std::ofstream& csv) {
+	const bool bWeak = kind[0] == 'w';
+	const ScalingRun& base = runs.front();
+	std::cout << (bWeak ? "Weak" : "Strong") << " scaling, " << (bWeak ? "from " : "") << base.spheres << " spheres, density " << base.density << ", "
+		<< base.frames << " frames\n";
+	std::cout << " threads  spheres    frame ms   sort ms  collide ms  other ms  speedup  efficiency  serial\n";
+
+	for (const ScalingRun& run : runs) {
+		const double threadRatio = double(run.threads) / base.threads;
+		double speedup = base.frameTime / run.frameTime;
+		double efficiency = speedup / threadRatio;
+		if (bWeak) {
+			efficiency = speedup;
+			speedup = efficiency * threadRatio;
+		}
+		//Karp-Flatt, the fraction of the work that would have to be serial to explain the speedup. Only means anything for a
+		//fixed world, and rising with the threads points at overheads that grow with them rather than a fixed serial part.
+		const bool bSerial = !bWeak && threadRatio > 1.0;
+		const double serial = bSerial ? (1.0 / speedup - 1.0 / threadRatio) / (1.0 - 1.0 / threadRatio) : 0.0;
+		const int bar = std::clamp(int(std::lround(efficiency * SCALING_BAR_WIDTH)), 0, SCALING_BAR_WIDTH);
+
+		std::cout << std::setw(8) << run.threads << std::setw(9) << run.spheres << std::setw(12) << run.frameTime << std::setw(10) << run.sortTime
+			<< std::setw(12) << run.collideTime << std::setw(10) << run.frameTime - run.sortTime - run.collideTime << std::setw(9) << speedup
+			<< std::setw(12) << efficiency;
+		if (bSerial) std::cout << std::setw(8) << serial;
+		else std::cout << std::setw(8) << "-";
+		std::cout << "  |" << std::string(bar, '#') << std::string(SCALING_BAR_WIDTH - bar, ' ') << "|\n";
+
+		if (csv) {
+			csv << kind << "," << run.threads << "," << run.spheres << "," << run.density << "," << run.frames << "," << run.frameTime << "," << run.sortTime
+				<< "," << run.collideTime << "," << run.frameTime - run.sortTime - run.collideTime << "," << speedup << "," << efficiency << ",";
+			if (bSerial) csv << serial;
+			csv << "\n";
+		}
+	}
+	std::cout << "\n";
+}
+
+void RunScalingSuite(const SimulationConfig& config, const ScalingMatrix& matrix, const std::string& csvPath) {
+	std::vector<int> threadCounts = matrix.threadCounts;
+	std::sort(threadCounts.begin(), threadCounts.end());
+	threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+	threadCounts.erase(std::remove_if(threadCounts.begin(), threadCounts.end(), [](int threads) { return threads < 1 || threads > MAX_WORKERS + 1; }), threadCounts.end());
+	if (threadCounts.empty() || matrix.sphereCounts.empty() || matrix.densities.empty()) {
+		std::cout << "Nothing to run, the scaling matrix needs thread counts, sphere counts and densities\n";
+		return;
+	}
+
+	std::ofstream csv;
+	if (!csvPath.empty()) {
+		csv.open(csvPath);
+		if (!csv) std::cout << "Couldn't open " << csvPath << ", writing tables only\n";
+		else csv << "scaling,threads,spheres,density,frames,frame_ms,sort_ms,collide_ms,other_ms,speedup,efficiency,serial_fraction\n";
+	}
+
+	const std::ios_base::fmtflags flags = std::cout.flags();
+	const std::streamsize precision = std::cout.precision();
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Scaling on " << NumCores() << " cores\n\n";
+
+	for (float density : matrix.densities) {
+		for (int spheres : matrix.sphereCounts) {
+			std::vector<ScalingRun> runs;
+			for (int threads : threadCounts) runs.emplace_back(TimeRun(config, threads, spheres, density, matrix.numFrames));
+			WriteTable("strong", runs, csv);
+		}
+	}
+
+	//A world only grows as far as the largest size asked for
+	const int maxSpheres = *std::max_element(matrix.sphereCounts.begin(), matrix.sphereCounts.end());
+	const double maxRatio = double(threadCounts.back()) / threadCounts.front();
+	for (float density : matrix.densities) {
+		for (int spheres : matrix.sphereCounts) {
+			if (threadCounts.size() < 2 || spheres * maxRatio > maxSpheres) continue;
+			//Every run steps as many frames as the first, bigger worlds would get fewer otherwise
+			std::vector<ScalingRun> runs;
+			int numFrames = matrix.numFrames;
+			for (int threads : threadCounts) {
+				runs.emplace_back(TimeRun(config, threads, int(double(spheres) * threads / threadCounts.front()), density, numFrames));
+				numFrames = runs.front().frames;
+			}
+			WriteTable("weak", runs, csv);
+		}
+	}
+
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "SimulationConfig.h"
+#include <vector>
+#include <string>
+
+//Every combination of thread count, world size and density the scaling suite runs
+struct ScalingMatrix {
+	//Threads including the main one, the smallest is what speedups are measured against
+	std::vector<int> threadCounts;
+	std::vector<int> sphereCounts;
+	//Fraction of the world's area covered by spheres, the world is sized to fit
+	std::vector<float> densities;
+	//Timed frames per run, -1 gives big worlds fewer frames so every run takes roughly as long
+	int numFrames = -1;
+};
+
+//Powers of two threads up to every core, 1k to 10M spheres and a sparse and a crowded density.
+ScalingMatrix DefaultScalingMatrix();
+
+//Strong scaling steps each world on every thread count. Weak scaling grows the world with the threads, starting from each
+//size that still fits the largest size when multiplied up. Prints a table per world of frame, sort and collision times with
+//speedup, parallel efficiency and the Karp-Flatt serial fraction, the efficiency drawn as a bar so runs diff line by line.
+//Every run is also written to csvPath for plotting when it isn't empty.
+//The adaptive scheduler is turned off so each run uses exactly the threads it's given.
+void RunScalingSuite(const SimulationConfig& config, const ScalingMatrix& matrix, const std::string& csvPath);
@@ -0,0 +1,505 @@
+#pragma once
+#include "Verify.h"
+#include "Simulation.h"
+#include "Collision.h"
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <memory>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+//Threading setups every trial's world is stepped through, each should land exactly where the reference does
+struct VerifyMode {
+	const char* name;
+	int numWorkers;
+	bool bAdaptive;
+	bool bSpinPark;
+	bool bStrip;
+	bool bCoherent;
+	bool bGraph;
+	bool bChunked;
+	bool bGrid;
+	bool bLod;
+};
+//LOD is only checked with its focus over the whole world. Slower tiles take the frames they missed in one go, which the per
+//frame reference can't follow. Slabs are checked by VerifySlabs, each slab process against a whole world stepped alongside.
+const VerifyMode VERIFY_MODES[] = {
+	{ "main thread only", 0, false, true, false, true, false, false, false, false },
+	{ "binary search sweep", 0, false, true, false, false, false, false, false, false },
+	{ "fixed split with strips", 3, false, true, true, true, false, false, false, false },
+	{ "fixed split on condition variables", 3, false, false, false, true, false, false, false, false },
+	{ "adaptive with strips", 3, true, true, true, true, false, false, false, false },
+	{ "adaptive", 2, true, true, false, true, false, false, false, false },
+	{ "task graph", 3, false, true, false, true, true, false, false, false },
+	{ "chunked", 0, false, true, false, true, false, true, false, false },
+	{ "chunked fixed split", 3, false, true, false, true, false, true, false, false },
+	{ "hierarchical grid", 0, false, true, false, true, false, false, true, false },
+	{ "hierarchical grid adaptive", 2, true, true, false, true, false, false, true, false },
+	{ "LOD at full rate", 3, true, true, false, true, false, false, false, true },
+};
+//Chunked modes split the world's width into about this many chunks, fewer if the halo makes them bigger
+const float VERIFY_CHUNKS_ACROSS = 12.0f;
+const char* BOUNDS_NAMES[] = { "reflective", "wrap", "open" };
+//Fixed point worlds have no reference to match, instead every setup must step them to exactly the same integers.
+//3-D worlds are stepped through the same setups against their own reference.
+const VerifyMode COMPACT_MODES[] = {
+	{ "main thread only", 0, false, true, false, true, false, false, false, false },
+	{ "fixed split", 3, false, true, false, true, false, false, false, false },
+	{ "adaptive", 2, true, true, false, true, false, false, false, false },
+};
+const char* STORAGE_NAMES[] = { "float", "fixed32", "fixed16" };
+//Processes a slab check splits each world between
+const int VERIFY_SLABS = 3;
+
+//Spheres stepped on their own, away from the simulation that owns the originals
+struct WorldCopy {
+	std::vector<CircleUpdateData> spheres;
+	std::vector<CircleUpdateData*> pointers;
+
+	WorldCopy(const std::vector<CircleUpdateData*>& source) {
+		spheres.reserve(source.size());
+		for (auto sphere : source) spheres.emplace_back(*sphere);
+		for (auto& sphere : spheres) pointers.emplace_back(&sphere);
+	}
+	WorldCopy(const WorldCopy&) = delete;
+	WorldCopy& operator=(const WorldCopy&) = delete;
+};
+
+//Allows for rounding differences only, a missed or extra collision moves a sphere by at least 0.05.
+//NaNs never match.
+bool Matches(float result, float expected) {
+	return std::abs(result - expected) <= 1e-4f + 2e-6f * std::abs(expected);
+}
+
+//Counts dynamics that don't match the expected sphere with the same id
+int CountMismatches(const std::vector<CircleUpdateData*>& result, const std::vector<CircleUpdateData>& expected) {
+	std::vector<const CircleUpdateData*> expectedById(expected.size(), nullptr);
+	for (auto& sphere : expected) expectedById.at(sphere.id) = &sphere;
+
+	int mismatches = int(std::max(result.size(), expected.size()) - std::min(result.size(), expected.size()));
+	for (auto sphere : result) {
+		auto match = expectedById.at(sphere->id);
+		if (!(Matches(sphere->pos.x, match->pos.x) && Matches(sphere->pos.y, match->pos.y) && Matches(sphere->velocity.x, match->velocity.x) && Matches(sphere->velocity.y, match->velocity.y))) mismatches++;
+	}
+	return mismatches;
+}
+
+//The current snapshot must hold every sphere where the simulation has it, sorted by x.
+bool SnapshotMatches(const CSimulation& simulation) {
+	auto snapshot = simulation.Queries().Snapshot();
+	if (!snapshot || snapshot->Size() != simulation.Statics().size() + simulation.Dynamics().size()) return false;
+
+	std::vector<SphereHit> hits;
+	snapshot->QueryRect({ -INFINITY, -INFINITY }, { INFINITY, INFINITY }, hits);
+	if (hits.size() != snapshot->Size()) return false;
+	for (size_t i = 1; i < hits.size(); i++) {
+		if (hits.at(i).pos.x < hits.at(i - 1).pos.x) return false;
+	}
+	std::vector<const CircleUpdateData*> dynamicById(simulation.Dynamics().size(), nullptr);
+	for (auto sphere : simulation.Dynamics()) dynamicById.at(sphere->id) = sphere;
+	int numDynamics = 0;
+	for (const auto& hit : hits) {
+		if (!hit.bDynamic) continue;
+		numDynamics++;
+		auto match = dynamicById.at(hit.id);
+		if (match->pos.x != hit.pos.x || match->pos.y != hit.pos.y) return false;
+	}
+	return numDynamics == int(simulation.Dynamics().size());
+}
+
+//A batch run on the pool must give exactly the hits each query gives run on its own against the same snapshot
+bool BatchMatches(const CSimulation& simulation, CQueryPool& pool, std::default_random_engine& gen) {
+	auto snapshot = simulation.Queries().Snapshot();
+	if (!snapshot) return false;
+	const SimulationConfig& config = simulation.Config();
+	std::uniform_real_distribution<> xDistribution(config.xMinCoord, config.xMaxCoord);
+	std::uniform_real_distribution<> yDistribution(config.yMinCoord, config.yMaxCoord);
+	std::vector<SphereQuery> queries(200);
+	for (size_t i = 0; i < queries.size(); i++) {
+		SphereQuery& query = queries.at(i);
+		query.type = SphereQuery::EType(i % 3);
+		query.min = { float(xDistribution(gen)), float(yDistribution(gen)) };
+		query.max = { query.min.x + config.MaxRadius() * 8.0f, query.min.y + config.MaxRadius() * 8.0f };
+		query.radius = config.MaxRadius() * 4.0f;
+		query.count = 1 + int(i % 7);
+	}
+
+	std::vector<std::vector<SphereHit>> results;
+	simulation.Queries().QueryBatch(queries, results, pool);
+	if (results.size() != queries.size()) return false;
+	std::vector<SphereHit> hits;
+	for (size_t i = 0; i < queries.size(); i++) {
+		hits.clear();
+		snapshot->Query(queries.at(i), hits);
+		//Ids are unique within statics and within dynamics, a later snapshot could only match by chance
+		if (hits.size() != results.at(i).size()) return false;
+		for (size_t h = 0; h < hits.size(); h++) {
+			if (hits.at(h).id != results.at(i).at(h).id || hits.at(h).bDynamic != results.at(i).at(h).bDynamic) return false;
+		}
+	}
+	return true;
+}
+
+//Random sphere count, radii, velocities and bounds, with the world sized so the spheres cover a random fraction of it.
+SimulationConfig RandomConfig(std::default_random_engine& gen) {
+	std::uniform_real_distribution<> unit(0.0, 1.0);
+	std::uniform_int_distribution<> amountDistribution(100, 3000);
+	std::uniform_real_distribution<> radiusDistribution(0.5, 30.0);
+	std::uniform_real_distribution<> coverageDistribution(0.02, 0.9);
+	std::uniform_real_distribution<> velocityDistribution(0.1, 2.0);
+
+	SimulationConfig config;
+	config.circleAmount = amountDistribution(gen);
+	config.sphereRadius = float(radiusDistribution(gen));
+	if (unit(gen) < 0.5) config.sphereRadiusVariation = float(unit(gen)) * config.sphereRadius * 0.9f;
+
+	const float sphereArea = 3.14159f * config.sphereRadius * config.sphereRadius;
+	const float halfSize = std::sqrt(config.circleAmount * sphereArea / float(coverageDistribution(gen))) * 0.5f;
+	config.xMinCoord = -halfSize;
+	config.xMaxCoord = halfSize;
+	config.yMinCoord = -halfSize;
+	config.yMaxCoord = halfSize;
+
+	const float velocityLimit = config.sphereRadius * float(velocityDistribution(gen));
+	config.xVelocityPosLimit = velocityLimit;
+	config.xVelocityNegLimit = -velocityLimit;
+	config.yVelocityPosLimit = velocityLimit;
+	config.yVelocityNegLimit = -velocityLimit;
+	config.bScaleByFrameTime = false;
+
+	config.bounds = EBounds(int(unit(gen) * 3.0) % 3);
+	config.seed = gen();
+	config.numSlabs = 1;
+	config.checkAllocations = false;
+	config.publishQueries = false;
+	//Drawn last so the rest of a seed's world is what it was before clusters. Clusters are never packed tighter than the
+	//densest even world, spheres piled deeper are pushed out past any chunk's halo.
+	if (unit(gen) < 0.3) {
+		config.numClusters = 1 + int(unit(gen) * 8.0);
+		const float packedRadius = std::sqrt(config.circleAmount * sphereArea / (config.numClusters * 3.14159f * 0.9f));
+		config.clusterRadius = std::max(halfSize * float(0.1 + unit(gen) * 0.4), packedRadius);
+	}
+	//Log-uniform radii spanning up to a couple of orders of magnitude, for the grid's levels. The mean radius stays where it was
+	//so the world is only a little less covered.
+	if (unit(gen) < 0.3) {
+		config.sphereRadiusVariation = float(0.5 + unit(gen) * 0.49) * config.sphereRadius;
+		config.bLogUniformRadius = true;
+	}
+	//The world the front ends ship with, the only one stepped by the kernels with its radius and bounds compiled in
+	if (unit(gen) < 0.2) {
+		const SimulationConfig shipped;
+		config.sphereRadius = shipped.sphereRadius;
+		config.sphereRadiusVariation = 0.0f;
+		config.bLogUniformRadius = false;
+		config.xMinCoord = shipped.xMinCoord;
+		config.xMaxCoord = shipped.xMaxCoord;
+		config.yMinCoord = shipped.yMinCoord;
+		config.yMaxCoord = shipped.yMaxCoord;
+	}
+	return config;
+}
+
+//Contact pairs found by the sweep and batched narrowphase against every overlapping pair, returns how many differ.
+int CheckContacts(const SimulationConfig& config, std::vector<CircleUpdateData*>& statics, const std::vector<CircleUpdateData*>& dynamics, CFrameArena& arena) {
+	std::vector<std::pair<int, int>> found;
+	std::vector<std::pair<int, int>> expected;
+	arena.Reset();
+	FindContacts(config, statics, dynamics, found, arena);
+	BruteForceContacts(statics, dynamics, expected);
+	std::sort(found.begin(), found.end());
+	std::sort(expected.begin(), expected.end());
+
+	std::vector<std::pair<int, int>> difference;
+	std::set_symmetric_difference(found.begin(), found.end(), expected.begin(), expected.end(), std::back_inserter(difference));
+	return int(difference.size());
+}
+
+//Steps one world through one setup, comparing against the reference every frame.
+//The reference starts each frame from the simulation's own state so one difference doesn't snowball. Returns failed checks.
+int VerifyWorld(const SimulationConfig& config, const VerifyMode& mode, bool bCheckKernels, int numFrames) {
+	CSimulation simulation(config);
+	simulation.Start();
+	if (config.lodScheduling) simulation.SetLodFocus({ config.xMinCoord, config.yMinCoord }, { config.xMaxCoord, config.yMaxCoord });
+	WorldCopy statics(simulation.Statics());
+	const ThreadUpdateFunction kernels[2] = { SelectKernel(config, simulation.Statics(), simulation.Dynamics()), GenericKernel() };
+	const char* kernelNames[2] = { "specialised kernel", "generic kernel" };
+	CFrameArena arena;
+	//Only started for setups that publish
+	std::unique_ptr<CQueryPool> queryPool(config.publishQueries ? new CQueryPool(3) : nullptr);
+	std::default_random_engine queryGen(config.seed);
+	int failures = 0;
+
+	for (int frame = 0; frame < numFrames; frame++) {
+		const int numDynamics = int(simulation.Dynamics().size());
+		WorldCopy expected(simulation.Dynamics());
+		arena.Reset();
+		ReferenceKernel()(config, statics.pointers, expected.pointers, 0, numDynamics, 1.0f, arena);
+
+		if (bCheckKernels) {
+			const int contactMismatches = CheckContacts(config, statics.pointers, simulation.Dynamics(), arena);
+			if (contactMismatches > 0) {
+				std::cout << "  frame " << frame << ": contact search differs on " << contactMismatches << " pairs\n";
+				failures++;
+			}
+			for (int k = 0; k < 2; k++) {
+				WorldCopy result(simulation.Dynamics());
+				arena.Reset();
+				kernels[k](config, statics.pointers, result.pointers, 0, numDynamics, 1.0f, arena);
+				const int mismatches = CountMismatches(result.pointers, expected.spheres);
+				if (mismatches > 0) {
+					std::cout << "  frame " << frame << ": " << kernelNames[k] << " differs on " << mismatches << " spheres\n";
+					failures++;
+				}
+			}
+		}
+
+		simulation.Step(1.0f / 60.0f);
+		const int mismatches = CountMismatches(simulation.Dynamics(), expected.spheres);
+		if (mismatches > 0) {
+			std::cout << "  frame " << frame << ": " << mode.name << " differs on " << mismatches << " spheres\n";
+			failures++;
+		}
+		if (config.publishQueries && !SnapshotMatches(simulation)) {
+			std::cout << "  frame " << frame << ": " << mode.name << " published a snapshot out of order or missing spheres\n";
+			failures++;
+		}
+		if (config.publishQueries && !BatchMatches(simulation, *queryPool, queryGen)) {
+			std::cout << "  frame " << frame << ": " << mode.name << " query batch differs from its queries run one at a time\n";
+			failures++;
+		}
+		//Later frames would only repeat the same difference
+		if (failures > 0) break;
+	}
+	return failures;
+}
+
+//Steps a fixed point world through every compact setup in lockstep, each frame's decoded dynamics must be bitwise identical
+//to the first setup's. Returns failed checks.
+int VerifyCompact(const SimulationConfig& trialConfig, int numFrames) {
+	std::vector<CSimulation*> simulations;
+	for (const auto& mode : COMPACT_MODES) {
+		SimulationConfig config = trialConfig;
+		config.numWorkers = mode.numWorkers;
+		config.adaptiveScheduling = mode.bAdaptive;
+		config.spinParkBarrier = mode.bSpinPark;
+		config.stripPartitioning = mode.bStrip;
+		config.coherentSweep = mode.bCoherent;
+		config.taskGraph = mode.bGraph;
+		simulations.emplace_back(new CSimulation(config));
+		simulations.back()->Start();
+	}
+
+	int failures = 0;
+	for (int frame = 0; frame < numFrames && failures == 0; frame++) {
+		for (auto simulation : simulations) simulation->Step(1.0f / 60.0f);
+		const auto& first = simulations.front()->Dynamics();
+		std::vector<const CircleUpdateData*> firstById(first.size(), nullptr);
+		for (auto sphere : first) firstById.at(sphere->id) = sphere;
+
+		for (size_t s = 1; s < simulations.size(); s++) {
+			const auto& dynamics = simulations.at(s)->Dynamics();
+			int mismatches = int(std::max(dynamics.size(), first.size()) - std::min(dynamics.size(), first.size()));
+			for (auto sphere : dynamics) {
+				auto match = firstById.at(sphere->id);
+				if (sphere->pos.x != match->pos.x || sphere->pos.y != match->pos.y || sphere->velocity.x != match->velocity.x || sphere->velocity.y != match->velocity.y) mismatches++;
+			}
+			if (mismatches > 0) {
+				std::cout << "  frame " << frame << ": " << COMPACT_MODES[s].name << " differs from " << COMPACT_MODES[0].name << " on " << mismatches << " spheres\n";
+				failures++;
+			}
+		}
+	}
+	for (auto simulation : simulations) delete simulation;
+	return failures;
+}
+
+//Steps the trial's world in 3-D through every compact setup, comparing against the volume's brute force reference every
+//frame. The box is a few of the largest spheres deep so they still pile up. Returns failed checks.
+int VerifyVolume(const SimulationConfig& trialConfig, int numFrames) {
+	int failures = 0;
+	for (const auto& mode : COMPACT_MODES) {
+		SimulationConfig config = trialConfig;
+		config.dimensions = 3;
+		const float halfDepth = std::max(2.0f * config.MaxRadius(), (config.xMaxCoord - config.xMinCoord) * 0.05f);
+		config.zMinCoord = -halfDepth;
+		config.zMaxCoord = halfDepth;
+		config.zVelocityPosLimit = config.xVelocityPosLimit;
+		config.zVelocityNegLimit = config.xVelocityNegLimit;
+		config.numWorkers = mode.numWorkers;
+		config.adaptiveScheduling = mode.bAdaptive;
+		config.spinParkBarrier = mode.bSpinPark;
+		config.coherentSweep = mode.bCoherent;
+		CSimulation simulation(config);
+		simulation.Start();
+
+		for (int frame = 0; frame < numFrames; frame++) {
+			CVolumeWorld expected(*simulation.Volume());
+			expected.Sort();
+			expected.UpdateReference(0, expected.NumDynamics(), 1.0f);
+			std::vector<const SphereUpdateData*> expectedBySphere(expected.NumDynamics(), nullptr);
+			for (auto& sphere : expected.DynamicSpheres()) expectedBySphere.at(sphere.sphere) = &sphere;
+
+			simulation.Step(1.0f / 60.0f);
+			int mismatches = 0;
+			for (auto& sphere : simulation.Volume()->DynamicSpheres()) {
+				auto match = expectedBySphere.at(sphere.sphere);
+				if (!(Matches(sphere.pos.x, match->pos.x) && Matches(sphere.pos.y, match->pos.y) && Matches(sphere.pos.z, match->pos.z)
+					&& Matches(sphere.velocity.x, match->velocity.x) && Matches(sphere.velocity.y, match->velocity.y) && Matches(sphere.velocity.z, match->velocity.z))) mismatches++;
+			}
+			if (mismatches > 0) {
+				std::cout << "  frame " << frame << ": 3-D " << mode.name << " differs on " << mismatches << " spheres\n";
+				failures++;
+				break;
+			}
+		}
+	}
+	return failures;
+}
+
+//Steps the world split into slabs, each process stepping the whole world alongside its own slab in one process. Every
+//slab's dynamics must be where the whole world has them, and the slabs must hold every dynamic between them. Slabs report
+//their failures back to rank 0 through a pipe before exiting. Returns failed checks.
+int VerifySlabs(const SimulationConfig& trialConfig, int numFrames) {
+#ifdef _WIN32
+	return 0;
+#else
+	int results[2];
+	if (pipe(results) != 0) {
+		std::cout << "  couldn't open a pipe for the slab processes to report through\n";
+		return 1;
+	}
+	int failures = 0;
+	int rank = 0;
+	int numRanks = 1;
+	int numDynamics = 0;
+	{
+		SimulationConfig config = trialConfig;
+		config.numWorkers = 0;
+		config.numSlabs = VERIFY_SLABS;
+		CSimulation slabs(config);
+		slabs.Start();
+		rank = slabs.Rank();
+		numRanks = slabs.NumRanks();
+		config.numSlabs = 1;
+		CSimulation whole(config);
+		whole.Start();
+
+		for (int frame = 0; frame < numFrames; frame++) {
+			slabs.Step(1.0f / 60.0f);
+			whole.Step(1.0f / 60.0f);
+			std::vector<const CircleUpdateData*> wholeById(whole.Dynamics().size(), nullptr);
+			for (auto sphere : whole.Dynamics()) wholeById.at(sphere->id) = sphere;
+
+			int mismatches = 0;
+			for (auto sphere : slabs.Dynamics()) {
+				auto match = wholeById.at(sphere->id);
+				if (!(Matches(sphere->pos.x, match->pos.x) && Matches(sphere->pos.y, match->pos.y) && Matches(sphere->velocity.x, match->velocity.x) && Matches(sphere->velocity.y, match->velocity.y))) mismatches++;
+			}
+			numDynamics = int(slabs.Dynamics().size());
+			//Slabs keep stepping in lockstep with their neighbours, only the first difference is reported
+			if (mismatches > 0 && failures == 0) {
+				std::cout << "  frame " << frame << ": slab " << rank << " differs on " << mismatches << " spheres\n";
+				failures++;
+			}
+		}
+		if (rank == 0 && failures == 0) numDynamics -= int(whole.Dynamics().size());
+	}
+
+	const int report[2] = { failures, numDynamics };
+	if (rank > 0) {
+		//Written in one go, well under what a pipe writes atomically
+		const bool bReported = write(results[1], report, sizeof(report)) == sizeof(report);
+		std::cout << std::flush;
+		_exit(bReported ? 0 : 1);
+	}
+	close(results[1]);
+	for (int r = 1; r < numRanks; r++) {
+		int slabReport[2] = { 1, 0 };
+		if (read(results[0], slabReport, sizeof(slabReport)) != sizeof(slabReport)) {
+			std::cout << "  a slab exited without reporting\n";
+			failures++;
+			break;
+		}
+		failures += slabReport[0];
+		numDynamics += slabReport[1];
+	}
+	close(results[0]);
+	//Once no slab has failed, their counts add up to the whole world's
+	if (failures == 0 && numDynamics != 0) {
+		std::cout << "  the slabs hold " << numDynamics << " dynamics more than the whole world\n";
+		failures++;
+	}
+	return failures;
+#endif
+}
+
+int VerifyAgainstReference(unsigned int seed, int numTrials, int numFrames) {
+	std::default_random_engine gen;
+	gen.seed(seed);
+	int failures = 0;
+
+	for (int trial = 0; trial < numTrials; trial++) {
+		const SimulationConfig trialConfig = RandomConfig(gen);
+		const float coverage = trialConfig.circleAmount * 3.14159f * trialConfig.sphereRadius * trialConfig.sphereRadius / ((trialConfig.xMaxCoord - trialConfig.xMinCoord) * (trialConfig.yMaxCoord - trialConfig.yMinCoord));
+		std::cout << "Trial " << trial << ": " << trialConfig.circleAmount << " spheres, radius " << trialConfig.sphereRadius << " +-" << trialConfig.sphereRadiusVariation
+			<< ", coverage " << coverage << ", " << BOUNDS_NAMES[int(trialConfig.bounds)] << " bounds, ";
+		if (trialConfig.bLogUniformRadius) std::cout << "log-uniform radii, ";
+		if (trialConfig.numClusters > 0) std::cout << trialConfig.numClusters << " clusters of radius " << trialConfig.clusterRadius << ", ";
+		std::cout << "seed " << trialConfig.seed << "\n";
+
+		for (int jacobi = 0; jacobi < 2; jacobi++) {
+			bool bFirstMode = true;
+			for (const auto& mode : VERIFY_MODES) {
+				SimulationConfig config = trialConfig;
+				config.jacobiResolution = jacobi == 1;
+				config.numWorkers = mode.numWorkers;
+				config.adaptiveScheduling = mode.bAdaptive;
+				config.spinParkBarrier = mode.bSpinPark;
+				config.stripPartitioning = mode.bStrip;
+				config.coherentSweep = mode.bCoherent;
+				config.taskGraph = mode.bGraph;
+				if (mode.bChunked) config.chunkSize = (config.xMaxCoord - config.xMinCoord) / VERIFY_CHUNKS_ACROSS;
+				if (mode.bGrid) config.broadphase = EBroadphase::HierarchicalGrid;
+				config.lodScheduling = mode.bLod;
+				//The graph publishes in pieces alongside the collision, so its snapshots are checked too
+				config.publishQueries = mode.bGraph;
+
+				const int worldFailures = VerifyWorld(config, mode, bFirstMode, numFrames);
+				if (worldFailures > 0) std::cout << "  in " << (config.jacobiResolution ? "jacobi" : "sequential") << " resolution, " << mode.name << "\n";
+				failures += worldFailures;
+				bFirstMode = false;
+			}
+
+			for (EPositionStorage storage : { EPositionStorage::Fixed32, EPositionStorage::Fixed16 }) {
+				SimulationConfig config = trialConfig;
+				config.jacobiResolution = jacobi == 1;
+				config.positionStorage = storage;
+				//Open bounds and spheres smaller than a few 16 bit quanta stay in floats, there's nothing to check
+				if (config.bounds == EBounds::Open) continue;
+				if (storage == EPositionStorage::Fixed16 && ICompactWorld::PositionStep(config, storage) * 16.0f > config.sphereRadius - config.sphereRadiusVariation) continue;
+
+				const int worldFailures = VerifyCompact(config, numFrames);
+				if (worldFailures > 0) std::cout << "  in " << (config.jacobiResolution ? "jacobi" : "sequential") << " resolution, " << STORAGE_NAMES[int(storage)] << " storage\n";
+				failures += worldFailures;
+			}
+
+			SimulationConfig config = trialConfig;
+			config.jacobiResolution = jacobi == 1;
+			const int slabFailures = VerifySlabs(config, numFrames);
+			if (slabFailures > 0) std::cout << "  in " << (config.jacobiResolution ? "jacobi" : "sequential") << " resolution, slabs\n";
+			failures += slabFailures;
+
+			const int worldFailures = VerifyVolume(config, numFrames);
+			if (worldFailures > 0) std::cout << "  in " << (config.jacobiResolution ? "jacobi" : "sequential") << " resolution, 3-D\n";
+			failures += worldFailures;
+		}
+	}
+
+	if (failures == 0) std::cout << "Every mode matched the reference\n";
+	else std::cout << failures << " checks failed\n";
+	return failures;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+//Steps randomised worlds through every dispatch mode, kernel and the contact search and checks each against the
+//brute force reference, frame by frame. Returns how many checks failed.
+int VerifyAgainstReference(unsigned int seed, int numTrials, int numFrames);
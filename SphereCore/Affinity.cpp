@@ -0,0 +1,174 @@
+#pragma once
+#include "Affinity.h"
+#include <vector>
+#include <thread>
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#endif
+
+#ifdef __linux__
+//Logical cpus the process may run on, which needn't be numbered from 0 or without gaps under a cpuset or with cpus offline.
+//Read once before any thread is pinned, afterwards the calling thread's mask would only be the cpus it was pinned to.
+static const std::vector<int>& UsableCpus() {
+	static const std::vector<int> cpus = []() {
+		std::vector<int> usable;
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) if (CPU_ISSET(cpu, &set)) usable.emplace_back(cpu);
+		}
+		else {
+			for (int cpu = 0; cpu < int(std::thread::hardware_concurrency()); cpu++) usable.emplace_back(cpu);
+		}
+		return usable;
+	}();
+	return cpus;
+}
+
+//Parses a sysfs cpu or node list such as "0-3,8-11"
+static std::vector<int> ParseList(const std::string& list) {
+	std::vector<int> values;
+	std::stringstream stream(list);
+	std::string range;
+	while (std::getline(stream, range, ',')) {
+		const size_t dash = range.find('-');
+		const int first = std::stoi(range.substr(0, dash));
+		const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+		for (int value = first; value <= last; value++) values.emplace_back(value);
+	}
+	return values;
+}
+
+//NUMA node of each usable cpu in UsableCpus order, -1 where the kernel doesn't say. Nodes rather than packages, as one
+//package can hold several nodes with sub-NUMA clustering, and that's what Windows pins a socket to as well.
+static const std::vector<int>& CpuNodes() {
+	static const std::vector<int> nodes = []() {
+		const std::vector<int>& cpus = UsableCpus();
+		std::vector<int> cpuNodes(cpus.size(), -1);
+		std::ifstream online("/sys/devices/system/node/online");
+		std::string onlineList;
+		if (!(online >> onlineList)) return cpuNodes;
+		for (int node : ParseList(onlineList)) {
+			std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+			std::string cpuList;
+			//Memory only nodes have no cpus
+			if (!(file >> cpuList)) continue;
+			for (int cpu : ParseList(cpuList)) {
+				auto found = std::find(cpus.begin(), cpus.end(), cpu);
+				if (found != cpus.end()) cpuNodes.at(found - cpus.begin()) = node;
+			}
+		}
+		return cpuNodes;
+	}();
+	return nodes;
+}
+#endif
+
+//NUMA nodes with at least one cpu the process may run on, ascending. Threads are spread over them by position, so nodes
+//outside a cpuset or without cpus never get a share.
+static const std::vector<int>& UsableNodes() {
+	static const std::vector<int> nodes = []() {
+		std::vector<int> usable;
+#ifdef _WIN32
+		ULONG highestNode = 0;
+		if (GetNumaHighestNodeNumber(&highestNode)) {
+			for (ULONG node = 0; node <= highestNode; node++) {
+				GROUP_AFFINITY groupAffinity = {};
+				if (GetNumaNodeProcessorMaskEx(USHORT(node), &groupAffinity) && groupAffinity.Mask != 0) usable.emplace_back(int(node));
+			}
+		}
+#elif defined(__linux__)
+		for (int node : CpuNodes()) if (node >= 0) usable.emplace_back(node);
+		std::sort(usable.begin(), usable.end());
+		usable.erase(std::unique(usable.begin(), usable.end()), usable.end());
+#endif
+		return usable;
+	}();
+	return nodes;
+}
+
+#ifdef _WIN32
+//Finds the processor group and index within it of the machine's nth active logical processor, counting group by group
+static bool NthProcessor(int n, WORD& group, int& index) {
+	const WORD numGroups = GetActiveProcessorGroupCount();
+	for (WORD g = 0; g < numGroups; g++) {
+		const int inGroup = int(GetActiveProcessorCount(g));
+		if (n < inGroup) {
+			group = g;
+			index = n;
+			return true;
+		}
+		n -= inGroup;
+	}
+	return false;
+}
+#endif
+
+int NumSockets() {
+	const int numNodes = int(UsableNodes().size());
+	return numNodes > 0 ? numNodes : 1;
+}
+
+int NumCores() {
+#ifdef _WIN32
+	const int numCores = int(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS));
+#elif defined(__linux__)
+	const int numCores = int(UsableCpus().size());
+#else
+	const int numCores = int(std::thread::hardware_concurrency());
+#endif
+	return numCores > 0 ? numCores : 1;
+}
+
+bool PinCurrentThread(EAffinity affinity, int thread, int numThreads) {
+	if (affinity == EAffinity::None) return true;
+
+	//Neighbouring threads work on neighbouring x-strips so they're kept on the same node
+	const std::vector<int>& nodes = UsableNodes();
+	const int numNodes = int(nodes.size());
+	const int nodeIndex = (thread * numNodes) / (numThreads > 0 ? numThreads : 1);
+
+#ifdef _WIN32
+	//Machines past 64 logical processors split them into groups, a thread is pinned within one group at a time
+	GROUP_AFFINITY groupAffinity = {};
+	if (affinity == EAffinity::Core) {
+		WORD group = 0;
+		int index = 0;
+		if (!NthProcessor(thread % NumCores(), group, index)) return false;
+		groupAffinity.Group = group;
+		groupAffinity.Mask = KAFFINITY(1) << index;
+	}
+	else if (numNodes == 0 || !GetNumaNodeProcessorMaskEx(USHORT(nodes.at(nodeIndex)), &groupAffinity)) return false;
+	return SetThreadGroupAffinity(GetCurrentThread(), &groupAffinity, nullptr) != 0;
+#elif defined(__linux__)
+	const std::vector<int>& cpus = UsableCpus();
+	const std::vector<int>& cpuNodes = CpuNodes();
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (affinity == EAffinity::Core) {
+		//Fills one node before moving to the next so core pinning keeps the same locality as node pinning, then any cpus
+		//whose node isn't exposed in the order they're numbered
+		std::vector<int> ordered;
+		for (int node : nodes) {
+			for (size_t i = 0; i < cpus.size(); i++) if (cpuNodes.at(i) == node) ordered.emplace_back(cpus.at(i));
+		}
+		for (size_t i = 0; i < cpus.size(); i++) if (cpuNodes.at(i) < 0) ordered.emplace_back(cpus.at(i));
+		if (ordered.empty()) return false;
+		CPU_SET(ordered.at(thread % ordered.size()), &set);
+	}
+	else {
+		if (numNodes == 0) return false;
+		for (size_t i = 0; i < cpus.size(); i++) if (cpuNodes.at(i) == nodes.at(nodeIndex)) CPU_SET(cpus.at(i), &set);
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+enum class EAffinity {
+	None,		//Leave scheduling to the OS
+	Core,		//Pin each thread to its own logical core
+	Socket		//Pin each thread to every core of one NUMA node, shared out over the nodes the process may run on
+};
+
+//Pins the calling thread. Thread 0 is the main thread, workers are 1 to numThreads - 1.
+//Returns false if the platform doesn't support the requested mode.
+bool PinCurrentThread(EAffinity affinity, int thread, int numThreads);
+
+//NUMA nodes with a core this process may run on, at least 1. Several per package with sub-NUMA clustering.
+int NumSockets();
+//Logical cores this process may run on, as first asked before any thread is pinned. Less than the machine has under a
+//restricted affinity mask or a container's cpuset, and on Windows counts every processor group rather than only the first 64 cores.
+int NumCores();
@@ -0,0 +1,70 @@
+#pragma once
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+//Relaxed is enough, the count is only read to compare two points on the same thread
+static std::atomic<size_t> heapAllocations{ 0 };
+
+size_t HeapAllocationCount()
+{
+	return heapAllocations.load(std::memory_order_relaxed);
+}
+
+static void* CountedAllocate(size_t size)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	void* memory = std::malloc(size ? size : 1);
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+static void* CountedAllocateAligned(size_t size, size_t alignment)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	size = size ? size : 1;
+#ifdef _WIN32
+	void* memory = _aligned_malloc(size, alignment);
+#else
+	//aligned_alloc wants the size to be a multiple of the alignment
+	void* memory = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+static void FreeAligned(void* memory)
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	try { return CountedAllocate(size); }
+	catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	try { return CountedAllocate(size); }
+	catch (...) { return nullptr; }
+}
+void* operator new(size_t size, std::align_val_t alignment) { return CountedAllocateAligned(size, size_t(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return CountedAllocateAligned(size, size_t(alignment)); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { FreeAligned(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { FreeAligned(memory); }
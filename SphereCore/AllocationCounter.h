@@ -0,0 +1,6 @@
+#pragma once
+#include <cstddef>
+
+//Global operator new is replaced to count every heap allocation the program makes, from any thread.
+//Take the count before and after a stretch of code to see how many allocations it made.
+size_t HeapAllocationCount();
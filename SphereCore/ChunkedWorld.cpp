@@ -0,0 +1,211 @@
+#pragma once
+#include "ChunkedWorld.h"
+#include <algorithm>
+#include <cmath>
+
+//Chunk coordinates are kept this far from the int limits so a neighbour's coordinate never overflows
+const int MAX_CHUNK_COORD = 1 << 30;
+//The hash starts at 64 slots
+const int MIN_CHUNK_SLOT_BITS = 6;
+
+CChunkedWorld* CChunkedWorld::Create(const SimulationConfig& config, ThreadUpdateFunction kernel, const std::vector<CircleUpdateData*>& statics, const std::vector<CircleUpdateData*>& dynamics) {
+	if (config.chunkSize <= 0.0f) return nullptr;
+	CChunkedWorld* world = new CChunkedWorld(config, kernel);
+	for (auto sphere : statics) world->Acquire(world->Coord(sphere->pos.x), world->Coord(sphere->pos.y))->ownStatics.emplace_back(sphere);
+
+	//Dynamics go in as movers so they're placed and their chunks activated the way every later frame does it
+	world->movers.assign(dynamics.begin(), dynamics.end());
+	world->numDynamics = int(dynamics.size());
+	world->Migrate();
+	return world;
+}
+
+CChunkedWorld::CChunkedWorld(const SimulationConfig& Config, ThreadUpdateFunction Kernel) : config(Config), kernel(Kernel) {
+	//Like the strip margin but in both axes, a halo covers both radii plus a frame of movement and collision push out
+	const float maxStep = config.bScaleByFrameTime ? config.maxFrameTime : 1.0f;
+	const float maxVelocity = std::max({ std::abs(config.xVelocityPosLimit), std::abs(config.xVelocityNegLimit), std::abs(config.yVelocityPosLimit), std::abs(config.yVelocityNegLimit) });
+	halo = 4.0f * config.MaxRadius() + 2.0f * maxVelocity * maxStep;
+	chunkSize = std::max(config.chunkSize, halo);
+}
+
+CChunkedWorld::~CChunkedWorld() {
+	for (auto& slot : slots) delete slot.chunk;
+	for (auto chunk : spareChunks) delete chunk;
+}
+
+void CChunkedWorld::BeginFrame() {
+	workStarts.clear();
+	int total = 0;
+	for (auto chunk : activeChunks) {
+		//Dynamics only move a little each frame, arrivals are the only ones far out of place
+		auto& dynamics = chunk->dynamics;
+		for (size_t i = 1; i < dynamics.size(); i++) {
+			CircleUpdateData* sphere = dynamics[i];
+			size_t j = i;
+			for (; j > 0 && sphere->pos.x < dynamics[j - 1]->pos.x; j--) dynamics[j] = dynamics[j - 1];
+			dynamics[j] = sphere;
+		}
+		workStarts.emplace_back(total);
+		total += int(dynamics.size());
+	}
+	workStarts.emplace_back(total);
+}
+
+void CChunkedWorld::Update(int start, int amount, float frameTime, CFrameArena& arena) {
+	const int end = start + amount;
+	size_t first = std::upper_bound(workStarts.begin(), workStarts.end(), start) - workStarts.begin() - 1;
+	for (size_t c = first; c < activeChunks.size() && workStarts[c] < end; c++) {
+		const int from = std::max(start, workStarts[c]);
+		const int to = std::min(end, workStarts[c + 1]);
+		Chunk* chunk = activeChunks[c];
+		if (to > from) kernel(config, chunk->localStaticView, chunk->dynamics, from - workStarts[c], to - from, frameTime, arena);
+	}
+}
+
+void CChunkedWorld::Migrate() {
+	//Leavers are taken out in place so the rest stay sorted
+	for (auto chunk : activeChunks) {
+		auto& dynamics = chunk->dynamics;
+		size_t kept = 0;
+		for (auto sphere : dynamics) {
+			if (Key(Coord(sphere->pos.x), Coord(sphere->pos.y)) == chunk->key) dynamics[kept++] = sphere;
+			else movers.emplace_back(sphere);
+		}
+		dynamics.resize(kept);
+	}
+
+	for (auto sphere : movers) {
+		Chunk* chunk = Acquire(Coord(sphere->pos.x), Coord(sphere->pos.y));
+		chunk->dynamics.emplace_back(sphere);
+		if (chunk->bActive) continue;
+		chunk->bActive = true;
+		if (!chunk->bHaloBuilt) BuildHalo(*chunk);
+		activeChunks.emplace_back(chunk);
+	}
+	movers.clear();
+
+	//Chunks holding statics stay in the hash for the halos of their neighbours, only ones left with nothing are pooled
+	size_t kept = 0;
+	for (auto chunk : activeChunks) {
+		if (!chunk->dynamics.empty()) activeChunks[kept++] = chunk;
+		else {
+			chunk->bActive = false;
+			if (chunk->ownStatics.empty()) Release(chunk);
+		}
+	}
+	activeChunks.resize(kept);
+}
+
+void CChunkedWorld::Gather(std::vector<CircleUpdateData*>& dynamics) const {
+	dynamics.clear();
+	for (auto chunk : activeChunks) dynamics.insert(dynamics.end(), chunk->dynamics.begin(), chunk->dynamics.end());
+	std::sort(dynamics.begin(), dynamics.end(), SortCondition);
+}
+
+//Positions past the coordinate limit share the outermost chunks, NaNs go to the lowest
+int CChunkedWorld::Coord(float position) const {
+	const double coord = std::floor(double(position) / chunkSize);
+	if (!(coord > -MAX_CHUNK_COORD)) return -MAX_CHUNK_COORD;
+	if (coord > MAX_CHUNK_COORD) return MAX_CHUNK_COORD;
+	return int(coord);
+}
+
+size_t CChunkedWorld::Home(uint64_t key) const {
+	return size_t((key * 0x9E3779B97F4A7C15ull) >> (64 - slotBits));
+}
+
+CChunkedWorld::Chunk* CChunkedWorld::Find(uint64_t key) const {
+	if (slots.empty()) return nullptr;
+	const size_t mask = slots.size() - 1;
+	for (size_t i = Home(key); slots[i].chunk; i = (i + 1) & mask) {
+		if (slots[i].key == key) return slots[i].chunk;
+	}
+	return nullptr;
+}
+
+CChunkedWorld::Chunk* CChunkedWorld::Acquire(int x, int y) {
+	const uint64_t key = Key(x, y);
+	if (Chunk* chunk = Find(key)) return chunk;
+	if ((numChunks + 1) * 2 > int(slots.size())) Grow();
+
+	Chunk* chunk = nullptr;
+	if (spareChunks.empty()) chunk = new Chunk();
+	else {
+		chunk = spareChunks.back();
+		spareChunks.pop_back();
+	}
+	chunk->key = key;
+	chunk->x = x;
+	chunk->y = y;
+
+	const size_t mask = slots.size() - 1;
+	size_t i = Home(key);
+	while (slots[i].chunk) i = (i + 1) & mask;
+	slots[i] = { key, chunk };
+	numChunks++;
+	return chunk;
+}
+
+//Takes the chunk out of the hash, shifting back any later entry of the probe run that would no longer be found past the gap.
+//The chunk keeps its arrays' memory for whichever chunk it becomes next.
+void CChunkedWorld::Release(Chunk* chunk) {
+	const size_t mask = slots.size() - 1;
+	size_t gap = Home(chunk->key);
+	while (slots[gap].chunk != chunk) gap = (gap + 1) & mask;
+	for (size_t i = (gap + 1) & mask; slots[i].chunk; i = (i + 1) & mask) {
+		//An entry stays put if its home is cyclically after the gap and at or before where it is
+		const size_t home = Home(slots[i].key);
+		const bool bReachable = gap <= i ? (gap < home && home <= i) : (gap < home || home <= i);
+		if (bReachable) continue;
+		slots[gap] = slots[i];
+		gap = i;
+	}
+	slots[gap] = Slot();
+	numChunks--;
+
+	chunk->ownStatics.clear();
+	chunk->localStatics.clear();
+	chunk->localStaticView.clear();
+	chunk->dynamics.clear();
+	chunk->bHaloBuilt = false;
+	chunk->bActive = false;
+	spareChunks.emplace_back(chunk);
+}
+
+void CChunkedWorld::Grow() {
+	std::vector<Slot> old;
+	old.swap(slots);
+	slotBits = std::max(slotBits + 1, MIN_CHUNK_SLOT_BITS);
+	slots.assign(size_t(1) << slotBits, Slot());
+	const size_t mask = slots.size() - 1;
+	for (auto& slot : old) {
+		if (!slot.chunk) continue;
+		size_t i = Home(slot.key);
+		while (slots[i].chunk) i = (i + 1) & mask;
+		slots[i] = slot;
+	}
+}
+
+//Copies in every static from this chunk and its neighbours close enough to reach a dynamic inside it during a frame
+void CChunkedWorld::BuildHalo(Chunk& chunk) {
+	const float minX = float(double(chunk.x) * chunkSize) - halo;
+	const float minY = float(double(chunk.y) * chunkSize) - halo;
+	const float maxX = float(double(chunk.x + 1) * chunkSize) + halo;
+	const float maxY = float(double(chunk.y + 1) * chunkSize) + halo;
+
+	chunk.localStatics.clear();
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dx = -1; dx <= 1; dx++) {
+			const Chunk* neighbour = Find(Key(chunk.x + dx, chunk.y + dy));
+			if (neighbour == nullptr) continue;
+			for (auto sphere : neighbour->ownStatics) {
+				if (sphere->pos.x >= minX && sphere->pos.x < maxX && sphere->pos.y >= minY && sphere->pos.y < maxY) chunk.localStatics.emplace_back(*sphere);
+			}
+		}
+	}
+	std::sort(chunk.localStatics.begin(), chunk.localStatics.end(), [](const CircleUpdateData& a, const CircleUpdateData& b) { return a.pos.x < b.pos.x; });
+
+	chunk.localStaticView.clear();
+	for (auto& sphere : chunk.localStatics) chunk.localStaticView.emplace_back(&sphere);
+	chunk.bHaloBuilt = true;
+}
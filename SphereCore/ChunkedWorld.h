@@ -0,0 +1,87 @@
+#pragma once
+#include "SphereData.h"
+#include "SimulationConfig.h"
+#include "Collision.h"
+#include "FrameArena.h"
+#include <vector>
+#include <cstdint>
+
+//The world's spheres held in square chunks that only exist where there are spheres, for worlds far bigger than their
+//occupied area. Chunks are found through a hash of their grid coordinates, so empty space costs nothing and open bounds
+//can spread as far as spheres go. Each chunk keeps a packed copy of its own statics and those within a halo of it, sorted
+//by x, and the dynamics inside it. Work is laid out chunk after chunk over the active chunks only, a frame's split then
+//hands each thread whole chunks apart from at its ends. Dynamics that leave a chunk are moved to the one they're in after
+//each frame, and chunks left empty go back to a pool for the next that's needed.
+//A halo covers a frame's movement and a couple of collisions' push out, so a chunked world steps the same as a flat one
+//unless spheres are piled so deep that one is pushed through several others in a frame.
+class CChunkedWorld
+{
+public:
+	//Returns nullptr if the config's chunkSize is 0. statics must outlive the world, their copies are taken as chunks need them.
+	static CChunkedWorld* Create(const SimulationConfig& config, ThreadUpdateFunction kernel, const std::vector<CircleUpdateData*>& statics, const std::vector<CircleUpdateData*>& dynamics);
+	~CChunkedWorld();
+	CChunkedWorld(const CChunkedWorld&) = delete;
+	CChunkedWorld& operator=(const CChunkedWorld&) = delete;
+
+	//Sorts each active chunk's dynamics by x and lays out the frame's work, before any Update
+	void BeginFrame();
+	//Steps dynamics start to start + amount - 1 of the frame's work. Threads may update separate ranges at once.
+	void Update(int start, int amount, float frameTime, CFrameArena& arena);
+	//Moves dynamics into the chunks they've moved to and pools any chunk left with no spheres
+	void Migrate();
+	//Writes every dynamic into dynamics sorted by x
+	void Gather(std::vector<CircleUpdateData*>& dynamics) const;
+
+	int NumDynamics() const { return numDynamics; }
+	int NumChunks() const { return numChunks; }
+	int NumActiveChunks() const { return int(activeChunks.size()); }
+	int NumPooledChunks() const { return int(spareChunks.size()); }
+	//At least the halo, so a chunk's halo only ever reaches its eight neighbours
+	float ChunkSize() const { return chunkSize; }
+
+private:
+	struct Chunk {
+		uint64_t key = 0;
+		int x = 0;
+		int y = 0;
+		std::vector<CircleUpdateData*> ownStatics;
+		//Own and halo statics, copied in once when the chunk first has dynamics as statics never move
+		std::vector<CircleUpdateData> localStatics;
+		std::vector<CircleUpdateData*> localStaticView;
+		bool bHaloBuilt = false;
+		std::vector<CircleUpdateData*> dynamics;
+		bool bActive = false;
+	};
+	struct Slot {
+		uint64_t key = 0;
+		Chunk* chunk = nullptr;
+	};
+
+	CChunkedWorld(const SimulationConfig& config, ThreadUpdateFunction kernel);
+
+	int Coord(float position) const;
+	static uint64_t Key(int x, int y) { return uint64_t(uint32_t(x)) << 32 | uint32_t(y); }
+	size_t Home(uint64_t key) const;
+	Chunk* Find(uint64_t key) const;
+	Chunk* Acquire(int x, int y);
+	void Release(Chunk* chunk);
+	void Grow();
+	void BuildHalo(Chunk& chunk);
+
+	SimulationConfig config;
+	ThreadUpdateFunction kernel;
+	float chunkSize = 0.0f;
+	float halo = 0.0f;
+	int numDynamics = 0;
+	int numChunks = 0;
+
+	//Open addressed with linear probing, a power of two in size and never more than half full
+	std::vector<Slot> slots;
+	int slotBits = 0;
+	std::vector<Chunk*> spareChunks;
+
+	std::vector<Chunk*> activeChunks;
+	//Where each active chunk's dynamics start in the frame's work, with the total at the end
+	std::vector<int> workStarts;
+	std::vector<CircleUpdateData*> movers;
+};
@@ -0,0 +1,669 @@
+#pragma once
+#include "Collision.h"
+#include <algorithm>
+#include <cmath>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+//How far past a dynamic's reach the grid kernel gathers statics for sequential resolution, as a fraction of its radius.
+//Wider means fewer spheres pushed out of what was gathered and swept again, narrower means fewer candidates for the rest.
+const float GRID_PUSH_SLACK = 0.5f;
+
+//Statics a dynamic sphere's sweep reached, packed so the narrowphase runs over plain arrays.
+//Storage comes from the thread's frame arena and is only regrown when a sweep finds more candidates than before.
+struct ContactBuffer {
+	float* x = nullptr;
+	float* y = nullptr;
+	float* radius = nullptr;
+	float* distSq = nullptr;
+	int count = 0;
+	int capacity = 0;
+
+	void Reserve(CFrameArena& arena, int amount) {
+		count = 0;
+		if (amount <= capacity) return;
+		capacity = amount * 2;
+		x = arena.Allocate<float>(capacity);
+		y = arena.Allocate<float>(capacity);
+		radius = arena.Allocate<float>(capacity);
+		distSq = arena.Allocate<float>(capacity);
+	}
+};
+
+//The world every front end ships with, SimulationConfig's defaults. Kernels for it fold the radius and bounds into
+//constants instead of loading them from the config.
+struct ShippedWorld {
+	static constexpr float radius = 10.0f;
+	static constexpr float xMin = -5000.0f;
+	static constexpr float xMax = 5000.0f;
+	static constexpr float yMin = -5000.0f;
+	static constexpr float yMax = 5000.0f;
+
+	static bool Matches(const SimulationConfig& config) {
+		return config.sphereRadius == radius && config.xMinCoord == xMin && config.xMaxCoord == xMax && config.yMinCoord == yMin && config.yMaxCoord == yMax;
+	}
+};
+
+//Kernel policies, each configuration gets its own ThreadUpdate instantiation.
+//Every sphere sharing one radius keeps it in a register instead of loading radii altogether.
+struct UniformRadius {
+	float radius;
+	UniformRadius(const SimulationConfig& config) : radius(config.sphereRadius) {}
+	float Get(const CircleUpdateData*) const { return radius; }
+	float Max() const { return radius; }
+};
+//Uniform radius known at compile time, only picked when the config's radius matches the world's
+template <typename World>
+struct FixedRadius {
+	FixedRadius(const SimulationConfig&) {}
+	float Get(const CircleUpdateData*) const { return World::radius; }
+	float Max() const { return World::radius; }
+};
+//Sweeps can't stop at the first static out of its own reach as a larger one further along may still reach, so they run to the largest radius the config allows.
+struct PerSphereRadius {
+	float maxRadius;
+	PerSphereRadius(const SimulationConfig& config) : maxRadius(config.MaxRadius()) {}
+	float Get(const CircleUpdateData* sphere) const { return sphere->radius; }
+	float Max() const { return maxRadius; }
+};
+
+//Where the bounds policies get the world's edges from, the config or a world known at compile time
+struct ConfigExtents {
+	float xMin, xMax, yMin, yMax;
+	ConfigExtents(const SimulationConfig& config) : xMin(config.xMinCoord), xMax(config.xMaxCoord), yMin(config.yMinCoord), yMax(config.yMaxCoord) {}
+};
+template <typename World>
+struct FixedExtents {
+	static constexpr float xMin = World::xMin;
+	static constexpr float xMax = World::xMax;
+	static constexpr float yMin = World::yMin;
+	static constexpr float yMax = World::yMax;
+	FixedExtents(const SimulationConfig&) {}
+};
+
+template <typename Extents = ConfigExtents>
+struct ReflectiveBounds : Extents {
+	ReflectiveBounds(const SimulationConfig& config) : Extents(config) {}
+
+	void Apply(CircleUpdateData* sphere) const {
+		const vector2 spherePos = sphere->pos;
+		bool bVertUpdate = false;
+		bool bTopBreach = false;
+		bool bHoriUpdate = false;
+		bool bRightBreach = false;
+
+		if (spherePos.x >= this->xMax) {
+			bHoriUpdate = true;
+			bRightBreach = true;
+		}
+		else if (spherePos.x <= this->xMin) bHoriUpdate = true;
+
+		if (spherePos.y >= this->yMax) {
+			bVertUpdate = true;
+			bTopBreach = true;
+		}
+		else if (spherePos.y <= this->yMin) bVertUpdate = true;
+
+		if (bHoriUpdate) {
+			if (bRightBreach) sphere->pos.x = this->xMax;
+			else sphere->pos.x = this->xMin;
+			sphere->velocity.x = -sphere->velocity.x;
+		}
+		if (bVertUpdate) {
+			if (bTopBreach) sphere->pos.y = this->yMax;
+			else sphere->pos.y = this->yMin;
+			sphere->velocity.y = -sphere->velocity.y;
+		}
+	}
+};
+template <typename Extents = ConfigExtents>
+struct WrapBounds : Extents {
+	WrapBounds(const SimulationConfig& config) : Extents(config) {}
+
+	void Apply(CircleUpdateData* sphere) const {
+		if (sphere->pos.x >= this->xMax) sphere->pos.x -= this->xMax - this->xMin;
+		else if (sphere->pos.x < this->xMin) sphere->pos.x += this->xMax - this->xMin;
+		if (sphere->pos.y >= this->yMax) sphere->pos.y -= this->yMax - this->yMin;
+		else if (sphere->pos.y < this->yMin) sphere->pos.y += this->yMax - this->yMin;
+	}
+};
+struct OpenBounds {
+	OpenBounds(const SimulationConfig&) {}
+	void Apply(CircleUpdateData*) const {}
+};
+//Generic kernel, reads the bounds mode at runtime every sphere
+struct RuntimeBounds {
+	const SimulationConfig& config;
+	RuntimeBounds(const SimulationConfig& Config) : config(Config) {}
+
+	void Apply(CircleUpdateData* sphere) const {
+		switch (config.bounds) {
+		case EBounds::Reflective: ReflectiveBounds<>(config).Apply(sphere); break;
+		case EBounds::Wrap: WrapBounds<>(config).Apply(sphere); break;
+		case EBounds::Open: OpenBounds(config).Apply(sphere); break;
+		}
+	}
+};
+
+template <typename Radius>
+bool CollisionDetection(const Radius& radius, CircleUpdateData* staticSphere, CircleUpdateData* dynamicSphere);
+typedef std::vector<CircleUpdateData*>::iterator StaticIterator;
+
+template <typename Radius>
+void JacobiResolve(const Radius& radius, std::vector<CircleUpdateData*>& staticSpheresUpdateData, StaticIterator currStaticSphere, CircleUpdateData* dynamicSphere, ContactBuffer& contacts, CFrameArena& arena);
+void ApplyContacts(const ContactBuffer& contacts, CircleUpdateData* dynamicSphere, vector2 dynamicPos, float dynamicRadius);
+
+//Asks for a static's cache line ahead of the sweep reaching it, a no-op where the compiler has no way to
+inline void Prefetch(const void* address) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__)
+	__builtin_prefetch(address);
+#endif
+}
+
+//Finds the first static at or right of an x position, the same one std::lower_bound would.
+//A coherent cursor only searches for the first dynamic, after that it walks on from its last answer. Dynamics come sorted
+//by x so the walk is as long as the distance between them, runs forwards through memory, and the statics the coming
+//dynamics will reach are prefetched a sweep's width ahead as the window slides along.
+class StaticCursor
+{
+public:
+	StaticCursor(std::vector<CircleUpdateData*>& StaticSpheres, bool Coherent, float MaxReach) : staticSpheres(StaticSpheres), bCoherent(Coherent), maxReach(MaxReach) {}
+
+	StaticIterator Seek(float x) {
+		if (!bCoherent || !bPlaced) {
+			current = std::lower_bound(staticSpheres.begin(), staticSpheres.end(), x, [](CircleUpdateData* a, float x)
+				{
+					return a->pos.x < x;
+				});
+			prefetched = current;
+			bPlaced = true;
+			if (!bCoherent) return current;
+		}
+		else {
+			while (current != staticSpheres.begin() && (*(current - 1))->pos.x >= x) current--;
+			while (current != staticSpheres.end() && (*current)->pos.x < x) current++;
+			if (prefetched < current) prefetched = current;
+		}
+
+		//The right sweep reaches maxReach past x, everything up to a second reach beyond is fetched for the dynamics after
+		while (prefetched != staticSpheres.end() && (*prefetched)->pos.x < x + 2.0f * maxReach) {
+			Prefetch(*prefetched);
+			prefetched++;
+		}
+		return current;
+	}
+
+private:
+	std::vector<CircleUpdateData*>& staticSpheres;
+	bool bCoherent;
+	float maxReach;
+	bool bPlaced = false;
+	StaticIterator current;
+	//First static not yet prefetched
+	StaticIterator prefetched;
+};
+
+//Visits every static whose x distance from dynamicX is inside their combined radii, those at or right of it nearest first
+//and then those left of it nearest first. Statics must be sorted by x and currStaticSphere the first at or right of dynamicX.
+template <typename Radius, typename Visit>
+void SweepStatics(const Radius& radius, std::vector<CircleUpdateData*>& staticSpheresUpdateData, StaticIterator currStaticSphere, float dynamicX, float dynamicRadius, Visit visit) {
+	const float maxReach = radius.Max() + dynamicRadius;
+
+	//Rightwards sweep until no static further along could reach
+	for (auto sweepRight = currStaticSphere; sweepRight != staticSpheresUpdateData.end(); sweepRight++) {
+		const float xDiff = (*sweepRight)->pos.x - dynamicX;
+		if (xDiff >= maxReach) break;
+		if (xDiff < radius.Get(*sweepRight) + dynamicRadius) visit(*sweepRight);
+	}
+	//Leftwards sweep, starts one before the right sweep's first static and includes the first element
+	for (auto sweepLeft = currStaticSphere; sweepLeft != staticSpheresUpdateData.begin();) {
+		sweepLeft--;
+		const float xDiff = dynamicX - (*sweepLeft)->pos.x;
+		if (xDiff >= maxReach) break;
+		if (xDiff < radius.Get(*sweepLeft) + dynamicRadius) visit(*sweepLeft);
+	}
+}
+
+//Moves up to eight dynamics on by frameTime worth of velocity through the batch types, unused lanes are left at zero.
+//Dynamics only collide with statics, so stepping a batch before sweeping any of it lands each where stepping it just before its
+//own sweep would.
+inline void IntegrateBatch(CircleUpdateData* const* spheres, int count, float frameTime) {
+	float x[floatx8::WIDTH] = {};
+	float y[floatx8::WIDTH] = {};
+	float velocityX[floatx8::WIDTH] = {};
+	float velocityY[floatx8::WIDTH] = {};
+	for (int i = 0; i < count; i++) {
+		x[i] = spheres[i]->pos.x;
+		y[i] = spheres[i]->pos.y;
+		velocityX[i] = spheres[i]->velocity.x;
+		velocityY[i] = spheres[i]->velocity.y;
+	}
+	const vec2x8 stepped = vec2x8::Load(x, y) + vec2x8::Load(velocityX, velocityY) * floatx8::Broadcast(frameTime);
+	stepped.x.Store(x);
+	stepped.y.Store(y);
+	for (int i = 0; i < count; i++) spheres[i]->pos = { x[i], y[i] };
+}
+
+template <typename Radius, typename Bounds>
+void ThreadUpdateKernel(const SimulationConfig& config, std::vector<CircleUpdateData*>& staticSpheresUpdateData, std::vector<CircleUpdateData*>& dynamicSpheresUpdateData, int dynamicSphereStart, int dynamicSpheresAmount, float frameTime, CFrameArena& arena) {
+	const Radius radius(config);
+	const Bounds bounds(config);
+	const bool bJacobi = config.jacobiResolution;
+	ContactBuffer contacts;
+	StaticCursor cursor(staticSpheresUpdateData, config.coherentSweep, radius.Max() * 2.0f);
+
+	for (int i = 0; i < dynamicSpheresAmount; i++) {
+		if (i % floatx8::WIDTH == 0) IntegrateBatch(dynamicSpheresUpdateData.data() + dynamicSphereStart + i, std::min(dynamicSpheresAmount - i, int(floatx8::WIDTH)), frameTime);
+		auto currDynamicSphere = dynamicSpheresUpdateData.at(dynamicSphereStart + i);
+
+		auto currStaticSphere = cursor.Seek(currDynamicSphere->pos.x);
+		if (bJacobi) JacobiResolve(radius, staticSpheresUpdateData, currStaticSphere, currDynamicSphere, contacts, arena);
+		else {
+			//Each collision moves the sphere on before the next static is tested, the sweep itself stays where the sphere landed
+			SweepStatics(radius, staticSpheresUpdateData, currStaticSphere, currDynamicSphere->pos.x, radius.Get(currDynamicSphere), [&](CircleUpdateData* staticSphere)
+				{
+					CollisionDetection(radius, staticSphere, currDynamicSphere);
+				});
+		}
+
+		//Wall boundry collision code
+		bounds.Apply(currDynamicSphere);
+	}
+}
+
+//Statics a grid query found, with the key that puts them in the order the sweep visits them.
+//Storage comes from the thread's frame arena the same way as a ContactBuffer's.
+struct GridCandidates {
+	int* order = nullptr;
+	int* index = nullptr;
+	float* x = nullptr;
+	float* y = nullptr;
+	float* radius = nullptr;
+	int count = 0;
+	int capacity = 0;
+
+	//Doubles the arrays in the arena, the old ones are left until it's reset
+	void Grow(CFrameArena& arena) {
+		capacity = std::max(capacity * 2, 64);
+		order = Regrow(arena, order);
+		index = Regrow(arena, index);
+		x = Regrow(arena, x);
+		y = Regrow(arena, y);
+		radius = Regrow(arena, radius);
+	}
+
+	template <typename T>
+	T* Regrow(CFrameArena& arena, const T* old) {
+		T* grown = arena.Allocate<T>(capacity);
+		std::copy(old, old + count, grown);
+		return grown;
+	}
+};
+
+//The sweep visits statics at or right of a dynamic in ascending order then those left of it descending, and only those whose
+//x distance is inside their combined radii. Candidates from the grid are filtered and ordered the same way and then resolved
+//as the sweep would, so the kernel lands exactly where the sweep does. Sequential resolution can push a sphere into statics it
+//didn't start near, so those up to GRID_PUSH_SLACK of its radius further are gathered too, and any pushed further is swept.
+template <typename Bounds>
+void GridUpdateKernel(const SimulationConfig& config, const CHierarchicalGrid& grid, std::vector<CircleUpdateData*>& staticSpheresUpdateData, std::vector<CircleUpdateData*>& dynamicSpheresUpdateData, int dynamicSphereStart, int dynamicSpheresAmount, float frameTime, CFrameArena& arena) {
+	const PerSphereRadius radius(config);
+	const Bounds bounds(config);
+	const bool bJacobi = config.jacobiResolution;
+	const int numStatics = int(staticSpheresUpdateData.size());
+	GridCandidates candidates;
+	ContactBuffer contacts;
+	StaticCursor cursor(staticSpheresUpdateData, false, radius.Max() * 2.0f);
+	const float* gridX = grid.X();
+	const float* gridY = grid.Y();
+	const float* gridRadius = grid.Radius();
+	const int* gridIndex = grid.Index();
+
+	for (int i = 0; i < dynamicSpheresAmount; i++) {
+		if (i % floatx8::WIDTH == 0) IntegrateBatch(dynamicSpheresUpdateData.data() + dynamicSphereStart + i, std::min(dynamicSpheresAmount - i, int(floatx8::WIDTH)), frameTime);
+		auto currDynamicSphere = dynamicSpheresUpdateData.at(dynamicSphereStart + i);
+		const vector2 dynamicPos = currDynamicSphere->pos;
+		const float dynamicRadius = radius.Get(currDynamicSphere);
+		const float slack = bJacobi ? 0.0f : dynamicRadius * GRID_PUSH_SLACK;
+
+		candidates.count = 0;
+		grid.ForEachCell(dynamicPos, dynamicRadius + slack, [&](int begin, int end)
+			{
+				for (int c = begin; c < end; c++) {
+					const float reach = gridRadius[c] + dynamicRadius;
+					const float xDiff = gridX[c] - dynamicPos.x;
+					const bool bRight = xDiff >= 0.0f;
+					if (!((bRight ? xDiff : -xDiff) < reach)) continue;
+					//A little over so rounding never drops one the sweep would reach
+					const float yDiff = gridY[c] - dynamicPos.y;
+					const float gatherReach = (reach + slack) * 1.001f;
+					if (xDiff * xDiff + yDiff * yDiff > gatherReach * gatherReach) continue;
+
+					if (candidates.count == candidates.capacity) candidates.Grow(arena);
+					const int n = candidates.count++;
+					candidates.order[n] = bRight ? gridIndex[c] : 2 * numStatics - gridIndex[c];
+					candidates.index[n] = gridIndex[c];
+					candidates.x[n] = gridX[c];
+					candidates.y[n] = gridY[c];
+					candidates.radius[n] = gridRadius[c];
+				}
+			});
+
+		//Few enough candidates that an insertion sort is quickest
+		const int count = candidates.count;
+		for (int a = 1; a < count; a++) {
+			const int order = candidates.order[a];
+			const int index = candidates.index[a];
+			const float x = candidates.x[a];
+			const float y = candidates.y[a];
+			const float candidateRadius = candidates.radius[a];
+			int b = a;
+			for (; b > 0 && candidates.order[b - 1] > order; b--) {
+				candidates.order[b] = candidates.order[b - 1];
+				candidates.index[b] = candidates.index[b - 1];
+				candidates.x[b] = candidates.x[b - 1];
+				candidates.y[b] = candidates.y[b - 1];
+				candidates.radius[b] = candidates.radius[b - 1];
+			}
+			candidates.order[b] = order;
+			candidates.index[b] = index;
+			candidates.x[b] = x;
+			candidates.y[b] = y;
+			candidates.radius[b] = candidateRadius;
+		}
+
+		if (count > 0 && bJacobi) {
+			contacts.Reserve(arena, count);
+			std::copy(candidates.x, candidates.x + count, contacts.x);
+			std::copy(candidates.y, candidates.y + count, contacts.y);
+			std::copy(candidates.radius, candidates.radius + count, contacts.radius);
+			contacts.count = count;
+			if (DetectContacts(contacts.x, contacts.y, contacts.radius, count, dynamicPos, dynamicRadius, contacts.distSq) > 0) ApplyContacts(contacts, currDynamicSphere, dynamicPos, dynamicRadius);
+		}
+		else if (count > 0) {
+			const CircleUpdateData before = *currDynamicSphere;
+			bool bEscaped = false;
+			for (int c = 0; c < count && !bEscaped; c++) {
+				CollisionDetection(radius, staticSpheresUpdateData[candidates.index[c]], currDynamicSphere);
+				bEscaped = LengthSq(currDynamicSphere->pos - dynamicPos) >= slack * slack * 0.98f;
+			}
+			if (bEscaped) {
+				*currDynamicSphere = before;
+				SweepStatics(radius, staticSpheresUpdateData, cursor.Seek(dynamicPos.x), dynamicPos.x, dynamicRadius, [&](CircleUpdateData* staticSphere)
+					{
+						CollisionDetection(radius, staticSphere, currDynamicSphere);
+					});
+			}
+		}
+
+		//Wall boundry collision code
+		bounds.Apply(currDynamicSphere);
+	}
+}
+
+template <typename Radius>
+bool CollisionDetection(const Radius& radius, CircleUpdateData* staticSphere, CircleUpdateData* dynamicSphere) {
+	vector2 staticSpherePos = staticSphere->pos;
+	vector2 dynamicSpherePos = dynamicSphere->pos;
+	vector2 vectBetweenSpheres = staticSpherePos - dynamicSpherePos;
+
+	//Checks collision occurs
+	float vectDist = Length(vectBetweenSpheres);
+	float sphereRadiusCombined = radius.Get(staticSphere) + radius.Get(dynamicSphere);
+	//Coincident centres give no direction to push out along
+	if (vectDist <= sphereRadiusCombined && vectDist > 0.0f) {
+		//Works out reflected vector
+		vector2 normVectorBetweenSpheres = vectBetweenSpheres / vectDist;
+		float dotSpheresVectorNormVector = vectBetweenSpheres.x * normVectorBetweenSpheres.x + vectBetweenSpheres.y * normVectorBetweenSpheres.y;
+		vector2 reflectedDynamicMomentum = vectBetweenSpheres - 2 * dotSpheresVectorNormVector * normVectorBetweenSpheres;
+
+		//Works out new position in direction of reflected vector
+		float reflectDist = Length(reflectedDynamicMomentum);
+		vector2 normReflectedVec = reflectedDynamicMomentum / reflectDist;
+
+		//Pushes out along the reflected vector, away from the static, by half the overlap
+		vector2 newPosition = dynamicSpherePos + (normReflectedVec * (sphereRadiusCombined - vectDist + 0.1f) * 0.5f);
+
+		//Preserves momentum from before collision
+		float momentumDist = Length(dynamicSphere->velocity);
+		dynamicSphere->pos = newPosition;
+		dynamicSphere->velocity = normReflectedVec * momentumDist;
+		return true;
+	}
+	else return false;
+}
+
+//Order independent resolution. The sweep only gathers candidates, detection is a pure pass over them, then every
+//contact's correction is worked out from the same starting state and averaged into a single update.
+template <typename Radius>
+void JacobiResolve(const Radius& radius, std::vector<CircleUpdateData*>& staticSpheresUpdateData, StaticIterator currStaticSphere, CircleUpdateData* dynamicSphere, ContactBuffer& contacts, CFrameArena& arena) {
+	const vector2 dynamicPos = dynamicSphere->pos;
+	const float dynamicRadius = radius.Get(dynamicSphere);
+
+	//Counted first so the buffer is sized before gathering, the gather keeps the sweep's order
+	int numCandidates = 0;
+	SweepStatics(radius, staticSpheresUpdateData, currStaticSphere, dynamicPos.x, dynamicRadius, [&](CircleUpdateData*) { numCandidates++; });
+	if (numCandidates == 0) return;
+
+	contacts.Reserve(arena, numCandidates);
+	SweepStatics(radius, staticSpheresUpdateData, currStaticSphere, dynamicPos.x, dynamicRadius, [&](CircleUpdateData* staticSphere)
+		{
+			contacts.x[contacts.count] = staticSphere->pos.x;
+			contacts.y[contacts.count] = staticSphere->pos.y;
+			contacts.radius[contacts.count] = radius.Get(staticSphere);
+			contacts.count++;
+		});
+	if (DetectContacts(contacts.x, contacts.y, contacts.radius, contacts.count, dynamicPos, dynamicRadius, contacts.distSq) == 0) return;
+	ApplyContacts(contacts, dynamicSphere, dynamicPos, dynamicRadius);
+}
+
+//Same per contact correction CollisionDetection makes for every detected contact, each taken from dynamicPos, averaged into one update
+void ApplyContacts(const ContactBuffer& contacts, CircleUpdateData* dynamicSphere, vector2 dynamicPos, float dynamicRadius) {
+	const int count = contacts.count;
+	vector2 pushTotal = { 0.0f, 0.0f };
+	vector2 awayTotal = { 0.0f, 0.0f };
+	int numContacts = 0;
+	for (int i = 0; i < count; i++) {
+		const float sphereRadiusCombined = contacts.radius[i] + dynamicRadius;
+		if (contacts.distSq[i] > sphereRadiusCombined * sphereRadiusCombined) continue;
+
+		float vectDist = std::sqrt(contacts.distSq[i]);
+		if (vectDist <= 0.0f) continue;
+		const vector2 away = (dynamicPos - vector2{ contacts.x[i], contacts.y[i] }) / vectDist;
+		pushTotal = pushTotal + away * ((sphereRadiusCombined - vectDist + 0.1f) * 0.5f);
+		awayTotal = awayTotal + away;
+		numContacts++;
+	}
+	if (numContacts == 0) return;
+
+	float numContactsFloat = float(numContacts);
+	float awayDist = Length(awayTotal);
+	const float momentumDist = Length(dynamicSphere->velocity);
+	dynamicSphere->pos = dynamicPos + pushTotal / numContactsFloat;
+	//Contacts cancelling out exactly leave the direction of travel alone
+	if (awayDist > 0.0f) dynamicSphere->velocity = (awayTotal / awayDist) * momentumDist;
+}
+
+int DetectContacts(const float* candidateX, const float* candidateY, const float* candidateRadius, int count, vector2 pos, float radius, float* distSq) {
+	int overlapping = 0;
+	int i = 0;
+	const vec2x8 centre = vec2x8::Broadcast(pos);
+	const floatx8 radiusx8 = floatx8::Broadcast(radius);
+	for (; i + floatx8::WIDTH <= count; i += floatx8::WIDTH) {
+		const floatx8 reach = floatx8::Load(candidateRadius + i) + radiusx8;
+		const floatx8 candidateDistSq = LengthSq(vec2x8::Load(candidateX + i, candidateY + i) - centre);
+		candidateDistSq.Store(distSq + i);
+		overlapping += CountTrue(LessEqual(candidateDistSq, reach * reach));
+	}
+	for (; i < count; i++) {
+		const float reach = candidateRadius[i] + radius;
+		distSq[i] = LengthSq(vector2{ candidateX[i], candidateY[i] } - pos);
+		overlapping += distSq[i] <= reach * reach ? 1 : 0;
+	}
+	return overlapping;
+}
+
+ThreadUpdateFunction SelectKernel(const SimulationConfig& config, const std::vector<CircleUpdateData*>& staticSpheresUpdateData, const std::vector<CircleUpdateData*>& dynamicSpheresUpdateData) {
+	bool bUniformRadius = true;
+	for (auto sphere : staticSpheresUpdateData) bUniformRadius = bUniformRadius && sphere->radius == config.sphereRadius;
+	for (auto sphere : dynamicSpheresUpdateData) bUniformRadius = bUniformRadius && sphere->radius == config.sphereRadius;
+
+	if (bUniformRadius && ShippedWorld::Matches(config)) {
+		switch (config.bounds) {
+		case EBounds::Reflective: return &ThreadUpdateKernel<FixedRadius<ShippedWorld>, ReflectiveBounds<FixedExtents<ShippedWorld>>>;
+		case EBounds::Wrap: return &ThreadUpdateKernel<FixedRadius<ShippedWorld>, WrapBounds<FixedExtents<ShippedWorld>>>;
+		case EBounds::Open: return &ThreadUpdateKernel<FixedRadius<ShippedWorld>, OpenBounds>;
+		}
+	}
+	if (bUniformRadius) {
+		switch (config.bounds) {
+		case EBounds::Reflective: return &ThreadUpdateKernel<UniformRadius, ReflectiveBounds<>>;
+		case EBounds::Wrap: return &ThreadUpdateKernel<UniformRadius, WrapBounds<>>;
+		case EBounds::Open: return &ThreadUpdateKernel<UniformRadius, OpenBounds>;
+		}
+	}
+	switch (config.bounds) {
+	case EBounds::Reflective: return &ThreadUpdateKernel<PerSphereRadius, ReflectiveBounds<>>;
+	case EBounds::Wrap: return &ThreadUpdateKernel<PerSphereRadius, WrapBounds<>>;
+	case EBounds::Open: return &ThreadUpdateKernel<PerSphereRadius, OpenBounds>;
+	}
+	return GenericKernel();
+}
+
+GridUpdateFunction SelectGridKernel(const SimulationConfig& config) {
+	switch (config.bounds) {
+	case EBounds::Reflective: return &GridUpdateKernel<ReflectiveBounds<>>;
+	case EBounds::Wrap: return &GridUpdateKernel<WrapBounds<>>;
+	case EBounds::Open: return &GridUpdateKernel<OpenBounds>;
+	}
+	return &GridUpdateKernel<RuntimeBounds>;
+}
+
+ThreadUpdateFunction GenericKernel() {
+	return &ThreadUpdateKernel<PerSphereRadius, RuntimeBounds>;
+}
+
+//Brute force reference the fast paths are checked against. Every dynamic is tested against every static with no searching,
+//early outs or batching, in the same order the sweep visits them so sequential resolution lands in the same place.
+//Relies on the statics being sorted by x only to find that order. The response and bounds are written out here again
+//rather than shared with the kernels, so a mistake in theirs shows up as a difference instead of being repeated.
+void BruteForceKernel(const SimulationConfig& config, std::vector<CircleUpdateData*>& staticSpheresUpdateData, std::vector<CircleUpdateData*>& dynamicSpheresUpdateData, int dynamicSphereStart, int dynamicSpheresAmount, float frameTime, CFrameArena&) {
+	const int numStatics = int(staticSpheresUpdateData.size());
+
+	for (int i = 0; i < dynamicSpheresAmount; i++) {
+		auto dynamicSphere = dynamicSpheresUpdateData.at(dynamicSphereStart + i);
+		dynamicSphere->pos = dynamicSphere->pos + dynamicSphere->velocity * frameTime;
+
+		const vector2 dynamicPos = dynamicSphere->pos;
+		const float dynamicRadius = dynamicSphere->radius;
+		int split = 0;
+		while (split < numStatics && staticSpheresUpdateData.at(split)->pos.x < dynamicPos.x) split++;
+
+		//Statics at or right of the sphere nearest first, then those left of it nearest first
+		std::vector<CircleUpdateData*> order;
+		for (int j = split; j < numStatics; j++) order.emplace_back(staticSpheresUpdateData.at(j));
+		for (int j = split - 1; j >= 0; j--) order.emplace_back(staticSpheresUpdateData.at(j));
+
+		vector2 pushTotal = { 0.0f, 0.0f };
+		vector2 awayTotal = { 0.0f, 0.0f };
+		int numContacts = 0;
+		for (auto staticSphere : order) {
+			const float sphereRadiusCombined = staticSphere->radius + dynamicRadius;
+			if (!(std::abs(staticSphere->pos.x - dynamicPos.x) < sphereRadiusCombined)) continue;
+
+			//Sequential, each contact moves the sphere before the next is tested. It's pushed out by half the overlap along the
+			//line from the static's centre reflected back on itself, which points away from the static, and keeps its speed.
+			//Worked in the same steps as the kernels so rounding can't tip a later contact one way here and the other there.
+			if (!config.jacobiResolution) {
+				const vector2 toStatic = staticSphere->pos - dynamicSphere->pos;
+				const float vectDist = Length(toStatic);
+				if (vectDist > sphereRadiusCombined || vectDist <= 0.0f) continue;
+				const vector2 normal = toStatic / vectDist;
+				const vector2 reflected = toStatic - 2 * (toStatic.x * normal.x + toStatic.y * normal.y) * normal;
+				const vector2 away = reflected / Length(reflected);
+				const float momentumDist = Length(dynamicSphere->velocity);
+				dynamicSphere->pos = dynamicSphere->pos + (away * (sphereRadiusCombined - vectDist + 0.1f) * 0.5f);
+				dynamicSphere->velocity = away * momentumDist;
+				continue;
+			}
+			const vector2 between = dynamicPos - staticSphere->pos;
+			if (LengthSq(between) > sphereRadiusCombined * sphereRadiusCombined) continue;
+			const float vectDist = Length(between);
+			if (vectDist <= 0.0f) continue;
+			pushTotal = pushTotal + (between / vectDist) * ((sphereRadiusCombined - vectDist + 0.1f) * 0.5f);
+			awayTotal = awayTotal + between / vectDist;
+			numContacts++;
+		}
+		if (numContacts > 0) {
+			const float awayDist = Length(awayTotal);
+			const float momentumDist = Length(dynamicSphere->velocity);
+			dynamicSphere->pos = dynamicPos + pushTotal / float(numContacts);
+			if (awayDist > 0.0f) dynamicSphere->velocity = (awayTotal / awayDist) * momentumDist;
+		}
+
+		vector2& pos = dynamicSphere->pos;
+		vector2& velocity = dynamicSphere->velocity;
+		if (config.bounds == EBounds::Reflective) {
+			if (pos.x >= config.xMaxCoord || pos.x <= config.xMinCoord) velocity.x = -velocity.x;
+			if (pos.y >= config.yMaxCoord || pos.y <= config.yMinCoord) velocity.y = -velocity.y;
+			pos.x = std::min(std::max(pos.x, config.xMinCoord), config.xMaxCoord);
+			pos.y = std::min(std::max(pos.y, config.yMinCoord), config.yMaxCoord);
+		}
+		else if (config.bounds == EBounds::Wrap) {
+			const float width = config.xMaxCoord - config.xMinCoord;
+			const float height = config.yMaxCoord - config.yMinCoord;
+			if (pos.x >= config.xMaxCoord) pos.x -= width;
+			else if (pos.x < config.xMinCoord) pos.x += width;
+			if (pos.y >= config.yMaxCoord) pos.y -= height;
+			else if (pos.y < config.yMinCoord) pos.y += height;
+		}
+	}
+}
+
+ThreadUpdateFunction ReferenceKernel() {
+	return &BruteForceKernel;
+}
+
+void FindContacts(const SimulationConfig& config, std::vector<CircleUpdateData*>& staticSpheresUpdateData, const std::vector<CircleUpdateData*>& dynamicSpheresUpdateData, std::vector<std::pair<int, int>>& contactPairs, CFrameArena& arena) {
+	const PerSphereRadius radius(config);
+	ContactBuffer contacts;
+	std::vector<int> candidateIds;
+	//Searches for every dynamic, these needn't be in x order
+	StaticCursor cursor(staticSpheresUpdateData, false, radius.Max() * 2.0f);
+
+	for (auto dynamicSphere : dynamicSpheresUpdateData) {
+		candidateIds.clear();
+		auto currStaticSphere = cursor.Seek(dynamicSphere->pos.x);
+		SweepStatics(radius, staticSpheresUpdateData, currStaticSphere, dynamicSphere->pos.x, dynamicSphere->radius, [&](CircleUpdateData* staticSphere) { candidateIds.emplace_back(staticSphere->id); });
+		if (candidateIds.empty()) continue;
+
+		contacts.Reserve(arena, int(candidateIds.size()));
+		SweepStatics(radius, staticSpheresUpdateData, currStaticSphere, dynamicSphere->pos.x, dynamicSphere->radius, [&](CircleUpdateData* staticSphere)
+			{
+				contacts.x[contacts.count] = staticSphere->pos.x;
+				contacts.y[contacts.count] = staticSphere->pos.y;
+				contacts.radius[contacts.count] = staticSphere->radius;
+				contacts.count++;
+			});
+		DetectContacts(contacts.x, contacts.y, contacts.radius, contacts.count, dynamicSphere->pos, dynamicSphere->radius, contacts.distSq);
+		for (int i = 0; i < contacts.count; i++) {
+			const float reach = contacts.radius[i] + dynamicSphere->radius;
+			if (contacts.distSq[i] <= reach * reach) contactPairs.emplace_back(dynamicSphere->id, candidateIds.at(i));
+		}
+	}
+}
+
+void BruteForceContacts(const std::vector<CircleUpdateData*>& staticSpheresUpdateData, const std::vector<CircleUpdateData*>& dynamicSpheresUpdateData, std::vector<std::pair<int, int>>& contactPairs) {
+	for (auto dynamicSphere : dynamicSpheresUpdateData) {
+		for (auto staticSphere : staticSpheresUpdateData) {
+			const float reach = staticSphere->radius + dynamicSphere->radius;
+			if (LengthSq(staticSphere->pos - dynamicSphere->pos) <= reach * reach) contactPairs.emplace_back(dynamicSphere->id, staticSphere->id);
+		}
+	}
+}
+
+bool SortCondition(CircleUpdateData* sphereA, CircleUpdateData* sphereB) {
+	return sphereA->pos.x < sphereB->pos.x;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "SphereData.h"
+#include "SimulationConfig.h"
+#include "FrameArena.h"
+#include "HierarchicalGrid.h"
+#include <vector>
+#include <utility>
+
+//Moves dynamicSpheresAmount dynamics from dynamicSphereStart by frameTime worth of velocity, collides them against
+//the x-sorted statics and applies the world bounds. Each kernel is one compile time specialisation of the sweep.
+typedef void (*ThreadUpdateFunction)(const SimulationConfig& config, std::vector<CircleUpdateData*>& staticSpheresUpdateData, std::vector<CircleUpdateData*>& dynamicSpheresUpdateData, int dynamicSphereStart, int dynamicSpheresAmount, float frameTime, CFrameArena& arena);
+
+//Picks the kernel instantiation matching this world once at startup.
+ThreadUpdateFunction SelectKernel(const SimulationConfig& config, const std::vector<CircleUpdateData*>& staticSpheresUpdateData, const std::vector<CircleUpdateData*>& dynamicSpheresUpdateData);
+//Per sphere radii and bounds checked at runtime, the baseline the specialised kernels are measured against.
+ThreadUpdateFunction GenericKernel();
+//O(statics * dynamics) kernel every other one should match, used to check them.
+ThreadUpdateFunction ReferenceKernel();
+
+//Steps dynamics like a ThreadUpdateFunction, finding each one's statics through a hierarchical grid built over the x-sorted
+//statics rather than sweeping them. Lands exactly where the sweep does.
+typedef void (*GridUpdateFunction)(const SimulationConfig& config, const CHierarchicalGrid& grid, std::vector<CircleUpdateData*>& staticSpheresUpdateData, std::vector<CircleUpdateData*>& dynamicSpheresUpdateData, int dynamicSphereStart, int dynamicSpheresAmount, float frameTime, CFrameArena& arena);
+GridUpdateFunction SelectGridKernel(const SimulationConfig& config);
+
+//Every overlapping (dynamic id, static id) pair, found by the kernels' sweep and batched narrowphase. Statics must be sorted by x.
+void FindContacts(const SimulationConfig& config, std::vector<CircleUpdateData*>& staticSpheresUpdateData, const std::vector<CircleUpdateData*>& dynamicSpheresUpdateData, std::vector<std::pair<int, int>>& contactPairs, CFrameArena& arena);
+//The same pairs found by testing every dynamic against every static.
+void BruteForceContacts(const std::vector<CircleUpdateData*>& staticSpheresUpdateData, const std::vector<CircleUpdateData*>& dynamicSpheresUpdateData, std::vector<std::pair<int, int>>& contactPairs);
+
+//Pure narrowphase, eight candidates at a time through the batch maths types. Returns how many candidates overlap.
+int DetectContacts(const float* candidateX, const float* candidateY, const float* candidateRadius, int count, vector2 pos, float radius, float* distSq);
+
+bool SortCondition(CircleUpdateData* sphereA, CircleUpdateData* sphereB);
@@ -0,0 +1,364 @@
+#pragma once
+#include "CompactWorld.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+const int32_t MAX_COMPACT_VELOCITY = 32767;
+//Room above the fastest starting speed, integer rounding can nudge a speed up a quantum each collision
+const float VELOCITY_HEADROOM = 1.25f;
+//Fraction bits of how far a velocity quantum moves a sphere in a frame, in position quanta
+const int MOVE_FRACTION_BITS = 32;
+//Fraction bits of the unit vectors Jacobi resolution adds up
+const int UNIT_FRACTION_BITS = 16;
+//The sort gives up on insertion and sorts from scratch after this many moves per dynamic, after wrapping for example
+const int SORT_MOVES_PER_DYNAMIC = 8;
+//Fixed16 needs a quantum under this fraction of the smallest radius
+const float MIN_FIXED16_QUANTA_PER_RADIUS = 16.0f;
+
+//Everything the integrate and collide loop reads or writes for a dynamic, 16 bytes with 32 bit positions and 12 with 16 bit
+template <typename Position>
+struct CompactDynamic {
+	Position x;
+	Position y;
+	int16_t velocityX;
+	int16_t velocityY;
+	//Where its sphere and radius are, the order dynamics were given in
+	uint32_t index;
+};
+
+//Rounds to nearest with halves away from zero, the same for either sign. denominator must be positive.
+static int64_t DivRound(int64_t numerator, int64_t denominator) {
+	return numerator >= 0 ? (numerator + denominator / 2) / denominator : -((-numerator + denominator / 2) / denominator);
+}
+
+//Largest integer whose square is at most value. The double square root is only a first guess so rounding can't change it.
+static int64_t ISqrt(int64_t value) {
+	if (value <= 0) return 0;
+	int64_t root = int64_t(std::sqrt(double(value)));
+	while (root * root > value) root--;
+	while ((root + 1) * (root + 1) <= value) root++;
+	return root;
+}
+
+template <typename Position>
+class CCompactWorld : public ICompactWorld
+{
+public:
+	typedef void (*Kernel)(CCompactWorld& world, int start, int amount);
+
+	CCompactWorld(const SimulationConfig& config, float PositionStep, float VelocityStep);
+	void Build(const SimulationConfig& config, std::vector<CircleUpdateData*>& statics, const std::vector<CircleUpdateData*>& dynamicSpheres);
+
+	int NumDynamics() const override { return int(dynamics.size()); }
+	void Sort() override;
+	void BeginFrame(float frameTime) override;
+	void Update(int start, int amount) override { kernel(*this, start, amount); }
+	void Decode(std::vector<CircleUpdateData*>& dynamicSpheres) const override;
+	float PositionStep() const override { return positionStep; }
+	float VelocityStep() const override { return velocityStep; }
+
+	int64_t Quantize(float value, float centre) const {
+		const int64_t limit = std::numeric_limits<Position>::max();
+		return std::clamp(int64_t(std::llround(double(value - centre) / positionStep)), -limit, limit);
+	}
+	static Position Store(int64_t value) {
+		const int64_t limit = std::numeric_limits<Position>::max();
+		return Position(std::clamp(value, -limit, limit));
+	}
+	static int16_t StoreVelocity(int64_t value) { return int16_t(std::clamp(value, int64_t(-MAX_COMPACT_VELOCITY), int64_t(MAX_COMPACT_VELOCITY))); }
+	int64_t Move(int16_t velocity) const { return DivRound(int64_t(velocity) * moveFactor, int64_t(1) << MOVE_FRACTION_BITS); }
+
+	float positionStep;
+	float velocityStep;
+	float centreX;
+	float centreY;
+	//Bounds in position quanta
+	int64_t xMin, xMax, yMin, yMax;
+	//The extra 0.1 collisions push apart by, at least a quantum
+	int64_t nudge;
+	//Position quanta a velocity quantum moves this frame, fixed point with MOVE_FRACTION_BITS
+	int64_t moveFactor = 0;
+	bool bJacobi;
+	bool bCoherent;
+
+	//Statics sorted by x
+	std::vector<Position> staticX;
+	std::vector<Position> staticY;
+	//Radii in position quanta, statics' by their sorted place and dynamics' by index, both empty when every radius is uniformRadius
+	std::vector<int32_t> staticRadius;
+	std::vector<int32_t> dynamicRadius;
+	int64_t uniformRadius = 0;
+	int64_t maxRadius = 0;
+
+	std::vector<CompactDynamic<Position>> dynamics;
+	//Each dynamic's sphere by index
+	std::vector<CircleUpdateData*> spheres;
+	Kernel kernel = nullptr;
+};
+
+//Kernel policies as for the float kernels
+struct CompactUniformRadius {
+	int64_t radius;
+	template <typename World>
+	CompactUniformRadius(const World& world) : radius(world.uniformRadius) {}
+	int64_t Static(int) const { return radius; }
+	int64_t Dynamic(uint32_t) const { return radius; }
+	int64_t Max() const { return radius; }
+};
+struct CompactPerSphereRadius {
+	const int32_t* statics;
+	const int32_t* dynamics;
+	int64_t maxRadius;
+	template <typename World>
+	CompactPerSphereRadius(const World& world) : statics(world.staticRadius.data()), dynamics(world.dynamicRadius.data()), maxRadius(world.maxRadius) {}
+	int64_t Static(int i) const { return statics[i]; }
+	int64_t Dynamic(uint32_t index) const { return dynamics[index]; }
+	int64_t Max() const { return maxRadius; }
+};
+
+struct CompactReflectiveBounds {
+	int64_t xMin, xMax, yMin, yMax;
+	template <typename World>
+	CompactReflectiveBounds(const World& world) : xMin(world.xMin), xMax(world.xMax), yMin(world.yMin), yMax(world.yMax) {}
+
+	void Apply(int64_t& x, int64_t& y, int64_t& velocityX, int64_t& velocityY) const {
+		if (x >= xMax || x <= xMin) {
+			x = x >= xMax ? xMax : xMin;
+			velocityX = -velocityX;
+		}
+		if (y >= yMax || y <= yMin) {
+			y = y >= yMax ? yMax : yMin;
+			velocityY = -velocityY;
+		}
+	}
+};
+struct CompactWrapBounds {
+	int64_t xMin, xMax, yMin, yMax;
+	template <typename World>
+	CompactWrapBounds(const World& world) : xMin(world.xMin), xMax(world.xMax), yMin(world.yMin), yMax(world.yMax) {}
+
+	void Apply(int64_t& x, int64_t& y, int64_t&, int64_t&) const {
+		if (x >= xMax) x -= xMax - xMin;
+		else if (x < xMin) x += xMax - xMin;
+		if (y >= yMax) y -= yMax - yMin;
+		else if (y < yMin) y += yMax - yMin;
+	}
+};
+
+//Same sweep and resolution as the float kernels, on integers. Positions are widened to 64 bits for the maths, which the
+//quantization leaves room for: combined radii come to at most 2^30 quanta as the world always reaches four radii past them.
+template <typename Position, typename Radius, typename Bounds>
+void CompactKernel(CCompactWorld<Position>& world, int start, int amount) {
+	const Radius radius(world);
+	const Bounds bounds(world);
+	const Position* staticX = world.staticX.data();
+	const Position* staticY = world.staticY.data();
+	const int numStatics = int(world.staticX.size());
+	int cursor = -1;
+
+	for (int i = start; i < start + amount; i++) {
+		CompactDynamic<Position>& dynamic = world.dynamics[i];
+		int64_t x = dynamic.x + world.Move(dynamic.velocityX);
+		int64_t y = dynamic.y + world.Move(dynamic.velocityY);
+		int64_t velocityX = dynamic.velocityX;
+		int64_t velocityY = dynamic.velocityY;
+		const int64_t dynamicRadius = radius.Dynamic(dynamic.index);
+		const int64_t maxReach = radius.Max() + dynamicRadius;
+
+		//First static at or right of the sphere, walked to from the last dynamic's when the sweep is coherent
+		if (!world.bCoherent || cursor < 0) cursor = int(std::lower_bound(staticX, staticX + numStatics, x) - staticX);
+		else {
+			while (cursor > 0 && staticX[cursor - 1] >= x) cursor--;
+			while (cursor < numStatics && staticX[cursor] < x) cursor++;
+		}
+		//Right then left, nearest first, from where the sphere was when the sweep started
+		const int64_t sweepX = x;
+		auto sweep = [&](auto visit) {
+			for (int j = cursor; j < numStatics; j++) {
+				const int64_t xDiff = staticX[j] - sweepX;
+				if (xDiff >= maxReach) break;
+				if (xDiff < radius.Static(j) + dynamicRadius) visit(j);
+			}
+			for (int j = cursor - 1; j >= 0; j--) {
+				const int64_t xDiff = sweepX - staticX[j];
+				if (xDiff >= maxReach) break;
+				if (xDiff < radius.Static(j) + dynamicRadius) visit(j);
+			}
+		};
+
+		if (world.bJacobi) {
+			//Integer sums don't depend on the order contacts are added in
+			int64_t pushX = 0;
+			int64_t pushY = 0;
+			int64_t awayX = 0;
+			int64_t awayY = 0;
+			int64_t numContacts = 0;
+			sweep([&](int j) {
+				const int64_t combined = radius.Static(j) + dynamicRadius;
+				const int64_t dx = x - staticX[j];
+				const int64_t dy = y - staticY[j];
+				if (dy > combined || dy < -combined) return;
+				const int64_t distSq = dx * dx + dy * dy;
+				if (distSq > combined * combined || distSq == 0) return;
+				const int64_t dist = std::max(ISqrt(distSq), int64_t(1));
+				const int64_t push = combined - dist + world.nudge;
+				pushX += DivRound(dx * push, 2 * dist);
+				pushY += DivRound(dy * push, 2 * dist);
+				awayX += DivRound(dx * (int64_t(1) << UNIT_FRACTION_BITS), dist);
+				awayY += DivRound(dy * (int64_t(1) << UNIT_FRACTION_BITS), dist);
+				numContacts++;
+			});
+			if (numContacts > 0) {
+				const int64_t speed = ISqrt(velocityX * velocityX + velocityY * velocityY);
+				const int64_t awayDist = ISqrt(awayX * awayX + awayY * awayY);
+				x += DivRound(pushX, numContacts);
+				y += DivRound(pushY, numContacts);
+				if (awayDist > 0) {
+					velocityX = DivRound(awayX * speed, awayDist);
+					velocityY = DivRound(awayY * speed, awayDist);
+				}
+			}
+		}
+		else {
+			//Each collision moves the sphere on before the next static is tested
+			sweep([&](int j) {
+				const int64_t combined = radius.Static(j) + dynamicRadius;
+				const int64_t dx = x - staticX[j];
+				const int64_t dy = y - staticY[j];
+				if (dx > combined || dx < -combined || dy > combined || dy < -combined) return;
+				const int64_t distSq = dx * dx + dy * dy;
+				if (distSq > combined * combined || distSq == 0) return;
+				const int64_t dist = std::max(ISqrt(distSq), int64_t(1));
+				const int64_t push = combined - dist + world.nudge;
+				const int64_t speed = ISqrt(velocityX * velocityX + velocityY * velocityY);
+				x += DivRound(dx * push, 2 * dist);
+				y += DivRound(dy * push, 2 * dist);
+				velocityX = DivRound(dx * speed, dist);
+				velocityY = DivRound(dy * speed, dist);
+			});
+		}
+
+		bounds.Apply(x, y, velocityX, velocityY);
+		dynamic.x = world.Store(x);
+		dynamic.y = world.Store(y);
+		dynamic.velocityX = world.StoreVelocity(velocityX);
+		dynamic.velocityY = world.StoreVelocity(velocityY);
+	}
+}
+
+template <typename Position>
+CCompactWorld<Position>::CCompactWorld(const SimulationConfig& config, float PositionStep, float VelocityStep) {
+	positionStep = PositionStep;
+	velocityStep = VelocityStep;
+	centreX = (config.xMinCoord + config.xMaxCoord) * 0.5f;
+	centreY = (config.yMinCoord + config.yMaxCoord) * 0.5f;
+	xMin = Quantize(config.xMinCoord, centreX);
+	xMax = Quantize(config.xMaxCoord, centreX);
+	yMin = Quantize(config.yMinCoord, centreY);
+	yMax = Quantize(config.yMaxCoord, centreY);
+	nudge = std::max(int64_t(1), int64_t(std::llround(0.1 / positionStep)));
+	bJacobi = config.jacobiResolution;
+	bCoherent = config.coherentSweep;
+}
+
+template <typename Position>
+void CCompactWorld<Position>::Build(const SimulationConfig& config, std::vector<CircleUpdateData*>& statics, const std::vector<CircleUpdateData*>& dynamicSpheres) {
+	bool bUniformRadius = true;
+	for (auto sphere : statics) bUniformRadius = bUniformRadius && sphere->radius == config.sphereRadius;
+	for (auto sphere : dynamicSpheres) bUniformRadius = bUniformRadius && sphere->radius == config.sphereRadius;
+	auto quantizeRadius = [&](float value) { return int32_t(std::llround(double(value) / positionStep)); };
+	uniformRadius = quantizeRadius(config.sphereRadius);
+	maxRadius = bUniformRadius ? uniformRadius : quantizeRadius(config.MaxRadius());
+
+	//Quantization never reorders, so statics stay sorted
+	for (auto sphere : statics) {
+		staticX.emplace_back(Store(Quantize(sphere->pos.x, centreX)));
+		staticY.emplace_back(Store(Quantize(sphere->pos.y, centreY)));
+		sphere->pos = { float(centreX + double(staticX.back()) * positionStep), float(centreY + double(staticY.back()) * positionStep) };
+		if (!bUniformRadius) staticRadius.emplace_back(quantizeRadius(sphere->radius));
+	}
+	for (auto sphere : dynamicSpheres) {
+		CompactDynamic<Position> dynamic;
+		dynamic.x = Store(Quantize(sphere->pos.x, centreX));
+		dynamic.y = Store(Quantize(sphere->pos.y, centreY));
+		dynamic.velocityX = StoreVelocity(std::llround(double(sphere->velocity.x) / velocityStep));
+		dynamic.velocityY = StoreVelocity(std::llround(double(sphere->velocity.y) / velocityStep));
+		dynamic.index = uint32_t(spheres.size());
+		dynamics.emplace_back(dynamic);
+		spheres.emplace_back(sphere);
+		if (!bUniformRadius) dynamicRadius.emplace_back(quantizeRadius(sphere->radius));
+	}
+	std::sort(dynamics.begin(), dynamics.end(), [](const CompactDynamic<Position>& a, const CompactDynamic<Position>& b) { return a.x < b.x; });
+
+	const bool bWrap = config.bounds == EBounds::Wrap;
+	if (bUniformRadius) kernel = bWrap ? &CompactKernel<Position, CompactUniformRadius, CompactWrapBounds> : &CompactKernel<Position, CompactUniformRadius, CompactReflectiveBounds>;
+	else kernel = bWrap ? &CompactKernel<Position, CompactPerSphereRadius, CompactWrapBounds> : &CompactKernel<Position, CompactPerSphereRadius, CompactReflectiveBounds>;
+}
+
+template <typename Position>
+void CCompactWorld<Position>::Sort() {
+	const int numDynamics = int(dynamics.size());
+	long long movesLeft = (long long)SORT_MOVES_PER_DYNAMIC * numDynamics;
+	for (int i = 1; i < numDynamics; i++) {
+		const CompactDynamic<Position> dynamic = dynamics[i];
+		int j = i;
+		while (j > 0 && dynamics[j - 1].x > dynamic.x) {
+			dynamics[j] = dynamics[j - 1];
+			j--;
+			if (--movesLeft < 0) {
+				dynamics[j] = dynamic;
+				std::sort(dynamics.begin(), dynamics.end(), [](const CompactDynamic<Position>& a, const CompactDynamic<Position>& b) { return a.x < b.x; });
+				return;
+			}
+		}
+		dynamics[j] = dynamic;
+	}
+}
+
+template <typename Position>
+void CCompactWorld<Position>::BeginFrame(float frameTime) {
+	moveFactor = std::llround(double(velocityStep) * frameTime / positionStep * double(int64_t(1) << MOVE_FRACTION_BITS));
+}
+
+template <typename Position>
+void CCompactWorld<Position>::Decode(std::vector<CircleUpdateData*>& dynamicSpheres) const {
+	dynamicSpheres.resize(dynamics.size());
+	for (size_t i = 0; i < dynamics.size(); i++) {
+		const CompactDynamic<Position>& dynamic = dynamics[i];
+		CircleUpdateData* sphere = spheres[dynamic.index];
+		sphere->pos = { float(centreX + double(dynamic.x) * positionStep), float(centreY + double(dynamic.y) * positionStep) };
+		sphere->velocity = { float(double(dynamic.velocityX) * velocityStep), float(double(dynamic.velocityY) * velocityStep) };
+		dynamicSpheres[i] = sphere;
+	}
+}
+
+float ICompactWorld::PositionStep(const SimulationConfig& config, EPositionStorage storage) {
+	if (storage == EPositionStorage::Float) return 0.0f;
+	//Half the world's longer side plus a frame's overshoot past the bounds
+	const float halfExtent = 0.5f * std::max(config.xMaxCoord - config.xMinCoord, config.yMaxCoord - config.yMinCoord) + config.StripMargin();
+	const double maxPosition = storage == EPositionStorage::Fixed16 ? std::numeric_limits<int16_t>::max() : std::numeric_limits<int32_t>::max();
+	return float(halfExtent / maxPosition);
+}
+
+ICompactWorld* ICompactWorld::Create(const SimulationConfig& config, std::vector<CircleUpdateData*>& statics, const std::vector<CircleUpdateData*>& dynamics) {
+	const float positionStep = PositionStep(config, config.positionStorage);
+	if (positionStep <= 0.0f || config.bounds == EBounds::Open) return nullptr;
+	const float minRadius = config.sphereRadius - config.sphereRadiusVariation;
+	if (config.positionStorage == EPositionStorage::Fixed16 && positionStep * MIN_FIXED16_QUANTA_PER_RADIUS > minRadius) return nullptr;
+
+	const float maxXVelocity = std::max(std::abs(config.xVelocityPosLimit), std::abs(config.xVelocityNegLimit));
+	const float maxYVelocity = std::max(std::abs(config.yVelocityPosLimit), std::abs(config.yVelocityNegLimit));
+	const float maxSpeed = std::sqrt(maxXVelocity * maxXVelocity + maxYVelocity * maxYVelocity);
+	const float velocityStep = std::max(maxSpeed * VELOCITY_HEADROOM, 1e-3f) / float(MAX_COMPACT_VELOCITY);
+
+	if (config.positionStorage == EPositionStorage::Fixed16) {
+		CCompactWorld<int16_t>* world = new CCompactWorld<int16_t>(config, positionStep, velocityStep);
+		world->Build(config, statics, dynamics);
+		return world;
+	}
+	CCompactWorld<int32_t>* world = new CCompactWorld<int32_t>(config, positionStep, velocityStep);
+	world->Build(config, statics, dynamics);
+	return world;
+}
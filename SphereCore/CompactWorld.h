@@ -0,0 +1,35 @@
+#pragma once
+#include "SphereData.h"
+#include "SimulationConfig.h"
+#include <vector>
+
+//The world's spheres stored as integers, positions in fixed point about the world centre and velocities in 16 bits, for
+//big worlds where stepping is bound by memory bandwidth. Statics are plain arrays of x, y and radius. Dynamics keep only
+//what the integrate and collide loop needs in one record: position, velocity and the index of their CircleUpdateData,
+//which keeps the id, hp and the float state the rest of the program reads. Collisions are worked out in integer maths
+//that gives the same answer on any thread, compiler or instruction set, so a world steps identically however it's split.
+//Positions are in quanta of PositionStep(), velocities of VelocityStep(). Reflective and wrap bounds only.
+class ICompactWorld
+{
+public:
+	virtual ~ICompactWorld() {}
+
+	//Quantizes the spheres, moving their floats onto the nearest quantum so both forms agree. statics must be sorted by x.
+	//Returns nullptr if the storage is Float, the bounds are open or the storage is too coarse for the smallest sphere.
+	static ICompactWorld* Create(const SimulationConfig& config, std::vector<CircleUpdateData*>& statics, const std::vector<CircleUpdateData*>& dynamics);
+	//Size of a position quantum for this config and storage, 0 for float storage
+	static float PositionStep(const SimulationConfig& config, EPositionStorage storage);
+
+	virtual int NumDynamics() const = 0;
+	//Sorts the dynamics by x, mostly sorted already so it's close to a single pass
+	virtual void Sort() = 0;
+	//Works out how far a velocity quantum moves a sphere this frame, before any Update
+	virtual void BeginFrame(float frameTime) = 0;
+	//Steps dynamics start to start + amount - 1 in sorted order. Threads may update separate ranges at once.
+	virtual void Update(int start, int amount) = 0;
+	//Writes the dynamics' positions and velocities back to their spheres, leaving dynamics in the sorted order
+	virtual void Decode(std::vector<CircleUpdateData*>& dynamics) const = 0;
+
+	virtual float PositionStep() const = 0;
+	virtual float VelocityStep() const = 0;
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include "Ensemble.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+CEnsemble::CEnsemble(int NumThreads) {
+	numThreads = NumThreads;
+	if (numThreads < 0) numThreads = NumCores();
+	if (numThreads <= 0) numThreads = 1;
+}
+
+void CEnsemble::Add(const SimulationConfig& config, int numFrames, float frameTime) {
+	World world;
+	world.config = config;
+	world.config.numWorkers = 0;
+	world.config.numSlabs = 1;
+	world.config.workerAffinity = EAffinity::None;
+	//The allocation counter is process wide so other worlds' setup would show up in every check
+	world.config.checkAllocations = false;
+	world.numFrames = numFrames;
+	world.frameTime = frameTime;
+	world.stepTimes.reserve(numFrames);
+	worlds.emplace_back(std::move(world));
+}
+
+void CEnsemble::Run() {
+	auto start = std::chrono::steady_clock::now();
+
+	//Biggest worlds go first so the last tasks left are the short ones
+	std::vector<int> order(worlds.size());
+	for (int i = 0; i < int(order.size()); i++) order.at(i) = i;
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return worlds.at(a).config.circleAmount > worlds.at(b).config.circleAmount; });
+	queue.assign(order.begin(), order.end());
+
+	//The calling thread is one of the pool
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; i++) threads.emplace_back(&CEnsemble::WorkerLoop, this);
+	WorkerLoop();
+	for (auto& thread : threads) thread.join();
+
+	wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void CEnsemble::WorkerLoop() {
+	while (true) {
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(queueLock);
+			if (queue.empty()) return;
+			index = queue.front();
+			queue.pop_front();
+		}
+
+		//Only one thread holds a world at a time so it needs no locking of its own.
+		//Generating the world is its first task, so setup runs spread over the pool too.
+		World& world = worlds.at(index);
+		if (!world.simulation) {
+			world.simulation.reset(new CSimulation(world.config));
+			world.simulation->Start();
+		}
+		else {
+			auto start = std::chrono::steady_clock::now();
+			world.simulation->Step(world.frameTime);
+			world.stepTimes.emplace_back(std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count());
+			world.framesDone++;
+		}
+
+		if (world.framesDone < world.numFrames) {
+			std::unique_lock<std::mutex> lock(queueLock);
+			queue.push_back(index);
+		}
+	}
+}
+
+void CEnsemble::Report(std::ostream& out) const {
+	double totalSphereSteps = 0.0;
+	for (int i = 0; i < int(worlds.size()); i++) {
+		const World& world = worlds.at(i);
+		if (world.stepTimes.empty()) continue;
+
+		std::vector<float> sorted = world.stepTimes;
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0.0;
+		for (float time : sorted) total += time;
+		const int numDynamics = world.config.circleAmount - world.config.circleAmount / 2;
+		const double sphereSteps = double(numDynamics) * world.framesDone;
+		totalSphereSteps += sphereSteps;
+
+		out << "World " << i << ": " << world.config.circleAmount << " spheres, velocity " << world.config.xVelocityPosLimit << ", seed " << world.config.seed
+			<< ", " << world.framesDone << " frames, mean " << total * 1000.0 / sorted.size() << "ms, median " << sorted.at(sorted.size() / 2) * 1000.0f
+			<< "ms, worst " << sorted.back() * 1000.0f << "ms, " << sphereSteps / total << " sphere steps per thread second\n";
+	}
+	out << "Ensemble of " << worlds.size() << " worlds on " << numThreads << " threads took " << wallTime << "s, " << totalSphereSteps / wallTime << " dynamic sphere steps per second\n";
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "Simulation.h"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+//Many independent worlds run by one process on one pool of threads, for parameter sweeps.
+//Each world steps on whichever thread picks it up with no workers of its own. A task is one frame of one world and the
+//world goes back in the queue until its frames are done, so threads never wait on each other and the pool stays busy
+//as long as there are more worlds than threads.
+class CEnsemble
+{
+public:
+	//numThreads of -1 uses every core
+	CEnsemble(int numThreads = -1);
+	CEnsemble(const CEnsemble&) = delete;
+	CEnsemble& operator=(const CEnsemble&) = delete;
+
+	//Worlds always run single threaded in one process, whatever the config asks for
+	void Add(const SimulationConfig& config, int numFrames, float frameTime = 1.0f / 60.0f);
+	//Generates and runs every world to completion
+	void Run();
+	//Per world frame times and throughput, then the ensemble's total
+	void Report(std::ostream& out) const;
+
+	int NumThreads() const { return numThreads; }
+
+private:
+	struct World {
+		SimulationConfig config;
+		int numFrames = 0;
+		float frameTime = 0.0f;
+		std::unique_ptr<CSimulation> simulation;
+		int framesDone = 0;
+		std::vector<float> stepTimes;
+	};
+
+	void WorkerLoop();
+
+	int numThreads = 1;
+	std::vector<World> worlds;
+
+	//Indices of worlds waiting for their next task, under queueLock
+	std::mutex queueLock;
+	std::deque<int> queue;
+	double wallTime = 0.0;
+};
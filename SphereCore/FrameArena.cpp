@@ -0,0 +1,44 @@
+#pragma once
+#include "FrameArena.h"
+
+CFrameArena::CFrameArena(size_t BlockSize)
+{
+	blockSize = BlockSize;
+}
+
+void* CFrameArena::Allocate(size_t size, size_t alignment)
+{
+	while (true) {
+		if (currentBlock < blocks.size()) {
+			Block& block = blocks.at(currentBlock);
+			const size_t base = reinterpret_cast<size_t>(block.memory.get());
+			const size_t aligned = (base + offset + alignment - 1) & ~(alignment - 1);
+			if (aligned + size <= base + block.size) {
+				offset = aligned + size - base;
+				return reinterpret_cast<void*>(aligned);
+			}
+
+			//Moves on to the next block, blocks already kept from earlier frames are reused first
+			currentBlock++;
+			offset = 0;
+			continue;
+		}
+
+		//Only grows while the arena is warming up to its largest frame
+		const size_t newSize = size + alignment > blockSize ? size + alignment : blockSize;
+		blocks.push_back({ std::unique_ptr<char[]>(new char[newSize]), newSize });
+	}
+}
+
+void CFrameArena::Reset()
+{
+	currentBlock = 0;
+	offset = 0;
+}
+
+size_t CFrameArena::Capacity() const
+{
+	size_t capacity = 0;
+	for (auto& block : blocks) capacity += block.size;
+	return capacity;
+}
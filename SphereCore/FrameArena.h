@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+//Bump allocator for a thread's scratch memory within one frame. Reset rewinds it without freeing,
+//so once its blocks have grown to the largest frame seen it never touches the heap again.
+//Destructors are never run, only use it for trivially destructible data.
+class CFrameArena
+{
+public:
+	CFrameArena(size_t blockSize = 256 * 1024);
+
+	void* Allocate(size_t size, size_t alignment);
+
+	template <typename T>
+	T* Allocate(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+
+	//Frees everything allocated since the last reset.
+	void Reset();
+
+	size_t Capacity() const;
+
+private:
+	struct Block {
+		std::unique_ptr<char[]> memory;
+		size_t size;
+	};
+
+	std::vector<Block> blocks;
+	size_t blockSize;
+	size_t currentBlock = 0;
+	size_t offset = 0;
+};
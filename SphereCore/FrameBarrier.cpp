@@ -0,0 +1,199 @@
+#pragma once
+#include "FrameBarrier.h"
+#include "Affinity.h"
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <iostream>
+#include <climits>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_PAUSE() _mm_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define CPU_PAUSE() asm volatile("yield")
+#else
+#define CPU_PAUSE()
+#endif
+#ifdef _WIN32
+#include <Windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const int SPIN_ITERATIONS = 2000;
+const int YIELD_ITERATIONS = 50;
+
+void CFrameBarrier::Reset(int NumWorkers)
+{
+	numWorkers = NumWorkers;
+	slots.reset(new WorkerSlot[numWorkers > 0 ? numWorkers : 1]);
+	generation = 0;
+	remaining = 0;
+	mainSleepers = 0;
+
+	//Main thread plus workers
+	const int numCores = NumCores();
+	const bool bOversubscribed = numCores <= numWorkers;
+	spinLimit = bOversubscribed ? 0 : SPIN_ITERATIONS;
+	yieldLimit = YIELD_ITERATIONS;
+}
+
+void CFrameBarrier::Release(int numActive)
+{
+	if (numActive > numWorkers) numActive = numWorkers;
+	remaining.store(numActive);
+	generation++;
+	for (int i = 0; i < numActive; i++) {
+		slots[i].generation.store(generation);
+		WakeAll(slots[i].generation, slots[i].sleepers);
+	}
+}
+
+void CFrameBarrier::WaitForWorkers()
+{
+	unsigned int left = remaining.load();
+	while (left != 0) {
+		SpinThenPark(remaining, left, mainSleepers);
+		left = remaining.load();
+	}
+}
+
+unsigned int CFrameBarrier::WaitForRelease(int worker, unsigned int seenGeneration)
+{
+	auto& slot = slots[worker];
+	SpinThenPark(slot.generation, seenGeneration, slot.sleepers);
+	return slot.generation.load();
+}
+
+void CFrameBarrier::Arrive()
+{
+	if (remaining.fetch_sub(1) == 1) WakeAll(remaining, mainSleepers);
+}
+
+void CFrameBarrier::SpinThenPark(std::atomic<unsigned int>& word, unsigned int value, std::atomic<int>& sleepers)
+{
+	for (int i = 0; i < spinLimit; i++) {
+		if (word.load(std::memory_order_acquire) != value) return;
+		CPU_PAUSE();
+	}
+	for (int i = 0; i < yieldLimit; i++) {
+		if (word.load(std::memory_order_acquire) != value) return;
+		std::this_thread::yield();
+	}
+
+	//Sleepers is raised before the final check and the waker changes the word before reading sleepers,
+	//both sequentially consistent, so either we see the change or the waker sees us
+	sleepers.fetch_add(1);
+	while (word.load() == value) {
+#ifdef _WIN32
+		WaitOnAddress(&word, &value, sizeof(value), INFINITE);
+#elif defined(__linux__)
+		syscall(SYS_futex, reinterpret_cast<unsigned int*>(&word), FUTEX_WAIT_PRIVATE, value, nullptr, nullptr, 0);
+#else
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+	}
+	sleepers.fetch_sub(1);
+}
+
+void CFrameBarrier::WakeAll(std::atomic<unsigned int>& word, std::atomic<int>& sleepers)
+{
+	if (sleepers.load() == 0) return;
+#ifdef _WIN32
+	WakeByAddressAll(&word);
+#elif defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<unsigned int*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+void BenchmarkFrameBarrier(int numWorkers, int numFrames)
+{
+	//Per worker condition variables, as collisionThread used to do
+	{
+		struct ConditionWorker {
+			std::mutex lock;
+			std::condition_variable bAvaliableWork;
+			bool bComplete = true;
+		};
+		std::vector<ConditionWorker> workers(numWorkers);
+		std::vector<std::thread> threads;
+		std::atomic<bool> bRunning{ true };
+		for (int i = 0; i < numWorkers; i++) {
+			threads.emplace_back([&, i]() {
+				auto& worker = workers.at(i);
+				while (true) {
+					{
+						std::unique_lock<std::mutex> lock(worker.lock);
+						worker.bAvaliableWork.wait(lock, [&]() {return !worker.bComplete; });
+						if (!bRunning) return;
+					}
+					{
+						std::unique_lock<std::mutex> lock(worker.lock);
+						worker.bComplete = true;
+					}
+					worker.bAvaliableWork.notify_one();
+				}
+				});
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < numFrames; frame++) {
+			for (auto& worker : workers) {
+				{
+					std::unique_lock<std::mutex> lock(worker.lock);
+					worker.bComplete = false;
+				}
+				worker.bAvaliableWork.notify_one();
+			}
+			for (auto& worker : workers) {
+				std::unique_lock<std::mutex> lock(worker.lock);
+				worker.bAvaliableWork.wait(lock, [&]() {return worker.bComplete; });
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		for (auto& worker : workers) {
+			std::unique_lock<std::mutex> lock(worker.lock);
+			bRunning = false;
+			worker.bComplete = false;
+			worker.bAvaliableWork.notify_one();
+		}
+		for (auto& thread : threads) thread.join();
+		std::cout << "Condition variables: " << std::chrono::duration<double, std::micro>(end - start).count() / numFrames << "us per frame\n";
+	}
+
+	//Spin then park barrier
+	{
+		CFrameBarrier barrier;
+		barrier.Reset(numWorkers);
+		std::atomic<bool> bRunning{ true };
+		std::vector<std::thread> threads;
+		for (int i = 0; i < numWorkers; i++) {
+			threads.emplace_back([&, i]() {
+				unsigned int generation = 0;
+				while (true) {
+					generation = barrier.WaitForRelease(i, generation);
+					if (!bRunning) return;
+					barrier.Arrive();
+				}
+				});
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < numFrames; frame++) {
+			barrier.Release();
+			barrier.WaitForWorkers();
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		bRunning = false;
+		barrier.Release();
+		for (auto& thread : threads) thread.join();
+		std::cout << "Spin then park barrier: " << std::chrono::duration<double, std::micro>(end - start).count() / numFrames << "us per frame\n";
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <memory>
+
+//Frame start/end synchronisation between the main thread and the collision workers.
+//Waiters spin with pause for a short while, back off by yielding, then park on the counter itself
+//(futex on Linux, WaitOnAddress on Windows) so a waker only pays for a system call when someone is asleep.
+class CFrameBarrier
+{
+public:
+	//Must be called before any worker waits on the barrier.
+	void Reset(int numWorkers);
+
+	//Main thread, starts a frame for the first numActive workers, the rest stay parked.
+	void Release(int numActive);
+	void Release() { Release(numWorkers); }
+	//Main thread, blocks until every released worker has called Arrive for the current frame.
+	void WaitForWorkers();
+
+	//Worker, blocks until a frame newer than seenGeneration is released to it and returns that frame's generation.
+	unsigned int WaitForRelease(int worker, unsigned int seenGeneration);
+	//Worker, marks this worker's share of the frame as done.
+	void Arrive();
+
+private:
+	//Each worker waits on its own word so workers left out of a frame are never woken.
+	//Aligned to a cache line so releasing one worker doesn't disturb its neighbour's spin.
+	struct alignas(64) WorkerSlot {
+		std::atomic<unsigned int> generation{ 0 };
+		std::atomic<int> sleepers{ 0 };
+	};
+
+	//Waits until word no longer holds value.
+	void SpinThenPark(std::atomic<unsigned int>& word, unsigned int value, std::atomic<int>& sleepers);
+	void WakeAll(std::atomic<unsigned int>& word, std::atomic<int>& sleepers);
+
+	std::unique_ptr<WorkerSlot[]> slots;
+	unsigned int generation = 0;
+	std::atomic<unsigned int> remaining{ 0 };
+	std::atomic<int> mainSleepers{ 0 };
+	int numWorkers = 0;
+	//No point spinning when there are more threads than cores, the thread being waited on can't run.
+	int spinLimit = 0;
+	int yieldLimit = 0;
+};
+
+//Times empty frames (release, every worker arrives, main waits) with the barrier and with one
+//condition variable per worker, the scheme collisionThread used before. Prints microseconds per frame.
+void BenchmarkFrameBarrier(int numWorkers, int numFrames);
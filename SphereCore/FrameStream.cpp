@@ -0,0 +1,248 @@
+#pragma once
+#include "FrameStream.h"
+#include <algorithm>
+#include <cstring>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Byte offsets of each array within a slot, optional arrays not in the stream are at 0
+struct SlotLayout {
+	size_t x = 0;
+	size_t y = 0;
+	size_t radius = 0;
+	size_t id = 0;
+	size_t velocityX = 0;
+	size_t velocityY = 0;
+	size_t hp = 0;
+	size_t bytes = 0;
+};
+
+//Every array starts on its own cache line
+static SlotLayout Layout(uint32_t capacity, uint32_t fields) {
+	const size_t arrayBytes = (size_t(capacity) * 4 + 63) / 64 * 64;
+	SlotLayout layout;
+	size_t offset = sizeof(FrameSlotHeader);
+	auto next = [&]() {
+		const size_t start = offset;
+		offset += arrayBytes;
+		return start;
+	};
+	layout.x = next();
+	layout.y = next();
+	layout.radius = next();
+	layout.id = next();
+	if (fields & StreamVelocity) {
+		layout.velocityX = next();
+		layout.velocityY = next();
+	}
+	if (fields & StreamHp) layout.hp = next();
+	layout.bytes = offset;
+	return layout;
+}
+
+//Points a frame's arrays into a slot
+static void SlotArrays(const char* slot, const SlotLayout& layout, StreamFrame& frame) {
+	frame.x = reinterpret_cast<const float*>(slot + layout.x);
+	frame.y = reinterpret_cast<const float*>(slot + layout.y);
+	frame.radius = reinterpret_cast<const float*>(slot + layout.radius);
+	frame.id = reinterpret_cast<const int32_t*>(slot + layout.id);
+	frame.velocityX = layout.velocityX ? reinterpret_cast<const float*>(slot + layout.velocityX) : nullptr;
+	frame.velocityY = layout.velocityY ? reinterpret_cast<const float*>(slot + layout.velocityY) : nullptr;
+	frame.hp = layout.hp ? reinterpret_cast<const int32_t*>(slot + layout.hp) : nullptr;
+}
+
+uint32_t StreamChecksum(const StreamFrame& frame) {
+	const int count = frame.numStatics + frame.numDynamics;
+	//Fletcher style, the second sum catches words being swapped or moved
+	uint64_t sum = uint64_t(uint32_t(frame.frame)) + uint64_t(count);
+	uint64_t sumOfSums = sum;
+	auto add = [&](const void* data) {
+		if (data == nullptr) return;
+		const char* bytes = static_cast<const char*>(data);
+		for (int i = 0; i < count; i++) {
+			uint32_t word;
+			std::memcpy(&word, bytes + size_t(i) * 4, 4);
+			sum += word;
+			sumOfSums += sum;
+		}
+	};
+	add(frame.x);
+	add(frame.y);
+	add(frame.radius);
+	add(frame.id);
+	add(frame.velocityX);
+	add(frame.velocityY);
+	add(frame.hp);
+	return uint32_t(sum ^ (sum >> 32) ^ (sumOfSums * 0x9E3779B97F4A7C15ull >> 32));
+}
+
+CFrameStreamWriter* CFrameStreamWriter::Create(const char* name, int capacity, int numSlots, uint32_t fields) {
+#ifdef _WIN32
+	return nullptr;
+#else
+	if (capacity < 0 || numSlots < 1) return nullptr;
+	const SlotLayout layout = Layout(uint32_t(capacity), fields);
+	const size_t size = sizeof(FrameStreamHeader) + size_t(numSlots) * layout.bytes;
+
+	//Anything left under the name by a run that didn't exit cleanly is replaced rather than reused
+	shm_unlink(name);
+	int file = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (file < 0) return nullptr;
+	if (ftruncate(file, off_t(size)) != 0) {
+		close(file);
+		shm_unlink(name);
+		return nullptr;
+	}
+	void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+	if (memory == MAP_FAILED) {
+		shm_unlink(name);
+		return nullptr;
+	}
+
+	//New shared memory is zeroed so every slot's version and the latest frame already start at 0
+	FrameStreamHeader* header = static_cast<FrameStreamHeader*>(memory);
+	header->version = FRAME_STREAM_VERSION;
+	header->numSlots = uint32_t(numSlots);
+	header->fields = fields;
+	header->capacity = uint32_t(capacity);
+	header->slotBytes = layout.bytes;
+	//Readers check the magic first, so it's only set once the rest of the header is
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = FRAME_STREAM_MAGIC;
+
+	CFrameStreamWriter* writer = new CFrameStreamWriter();
+	writer->name.assign(name, name + std::strlen(name) + 1);
+	writer->memory = static_cast<char*>(memory);
+	writer->size = size;
+	return writer;
+#endif
+}
+
+CFrameStreamWriter::~CFrameStreamWriter() {
+#ifndef _WIN32
+	munmap(memory, size);
+	shm_unlink(name.data());
+#endif
+}
+
+void CFrameStreamWriter::Write(int frame, const std::vector<CircleUpdateData*>& staticSpheres, const std::vector<CircleUpdateData*>& dynamicSpheres) {
+	FrameStreamHeader* header = reinterpret_cast<FrameStreamHeader*>(memory);
+	const SlotLayout layout = Layout(header->capacity, header->fields);
+	sequence++;
+	char* slot = memory + sizeof(FrameStreamHeader) + size_t(sequence % header->numSlots) * layout.bytes;
+	FrameSlotHeader* slotHeader = reinterpret_cast<FrameSlotHeader*>(slot);
+
+	//Odd while writing, the fence keeps every write below from landing before readers can see that
+	slotHeader->version.store(sequence * 2 - 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	const int capacity = int(header->capacity);
+	const int numStatics = std::min(int(staticSpheres.size()), capacity);
+	const int numDynamics = std::min(int(dynamicSpheres.size()), capacity - numStatics);
+	float* x = reinterpret_cast<float*>(slot + layout.x);
+	float* y = reinterpret_cast<float*>(slot + layout.y);
+	float* radius = reinterpret_cast<float*>(slot + layout.radius);
+	int32_t* id = reinterpret_cast<int32_t*>(slot + layout.id);
+	float* velocityX = reinterpret_cast<float*>(slot + layout.velocityX);
+	float* velocityY = reinterpret_cast<float*>(slot + layout.velocityY);
+	int32_t* hp = reinterpret_cast<int32_t*>(slot + layout.hp);
+	auto write = [&](int index, const CircleUpdateData* sphere) {
+		x[index] = sphere->pos.x;
+		y[index] = sphere->pos.y;
+		radius[index] = sphere->radius;
+		id[index] = sphere->id;
+		if (layout.velocityX) {
+			velocityX[index] = sphere->velocity.x;
+			velocityY[index] = sphere->velocity.y;
+		}
+		if (layout.hp) hp[index] = sphere->hp;
+	};
+	for (int i = 0; i < numStatics; i++) write(i, staticSpheres[i]);
+	for (int i = 0; i < numDynamics; i++) write(numStatics + i, dynamicSpheres[i]);
+
+	slotHeader->frame = frame;
+	slotHeader->numStatics = numStatics;
+	slotHeader->numDynamics = numDynamics;
+	StreamFrame written;
+	written.frame = frame;
+	written.numStatics = numStatics;
+	written.numDynamics = numDynamics;
+	SlotArrays(slot, layout, written);
+	slotHeader->checksum = StreamChecksum(written);
+
+	slotHeader->version.store(sequence * 2, std::memory_order_release);
+	header->latest.store(sequence, std::memory_order_release);
+}
+
+CFrameStreamReader* CFrameStreamReader::Open(const char* name) {
+#ifdef _WIN32
+	return nullptr;
+#else
+	int file = shm_open(name, O_RDONLY, 0);
+	if (file < 0) return nullptr;
+	struct stat info;
+	if (fstat(file, &info) != 0 || size_t(info.st_size) < sizeof(FrameStreamHeader)) {
+		close(file);
+		return nullptr;
+	}
+	const size_t size = size_t(info.st_size);
+	void* memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);
+	if (memory == MAP_FAILED) return nullptr;
+
+	const FrameStreamHeader* header = static_cast<const FrameStreamHeader*>(memory);
+	const bool bMagic = header->magic == FRAME_STREAM_MAGIC;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!bMagic || header->version != FRAME_STREAM_VERSION || header->numSlots == 0 || header->slotBytes != Layout(header->capacity, header->fields).bytes
+		|| size != sizeof(FrameStreamHeader) + size_t(header->numSlots) * header->slotBytes) {
+		munmap(memory, size);
+		return nullptr;
+	}
+
+	CFrameStreamReader* reader = new CFrameStreamReader();
+	reader->memory = static_cast<const char*>(memory);
+	reader->size = size;
+	return reader;
+#endif
+}
+
+CFrameStreamReader::~CFrameStreamReader() {
+#ifndef _WIN32
+	munmap(const_cast<char*>(memory), size);
+#endif
+}
+
+bool CFrameStreamReader::Latest(StreamFrame& frame) const {
+	const FrameStreamHeader* header = Header();
+	//The latest slot can only be taken again if the writer laps the whole ring in between, so a retry nearly always lands
+	for (int attempt = 0; attempt < 4; attempt++) {
+		const uint64_t sequence = header->latest.load(std::memory_order_acquire);
+		if (sequence == 0) return false;
+
+		const char* slot = memory + sizeof(FrameStreamHeader) + size_t(sequence % header->numSlots) * header->slotBytes;
+		const FrameSlotHeader* slotHeader = reinterpret_cast<const FrameSlotHeader*>(slot);
+		if (slotHeader->version.load(std::memory_order_acquire) != sequence * 2) continue;
+
+		frame.sequence = sequence;
+		frame.frame = slotHeader->frame;
+		frame.numStatics = slotHeader->numStatics;
+		frame.numDynamics = slotHeader->numDynamics;
+		frame.checksum = slotHeader->checksum;
+		SlotArrays(slot, Layout(header->capacity, header->fields), frame);
+		if (StillValid(frame)) return true;
+	}
+	return false;
+}
+
+bool CFrameStreamReader::StillValid(const StreamFrame& frame) const {
+	const FrameStreamHeader* header = Header();
+	const char* slot = memory + sizeof(FrameStreamHeader) + size_t(frame.sequence % header->numSlots) * header->slotBytes;
+	//Keeps every read of the frame before the version is looked at again
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return reinterpret_cast<const FrameSlotHeader*>(slot)->version.load(std::memory_order_relaxed) == frame.sequence * 2;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include "SphereData.h"
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+//Every frame's spheres written to a ring of slots in POSIX shared memory, for viewers and analysis tools in other processes.
+//The simulation never waits on a reader, it just moves on to the next slot. Each slot is guarded by a version that is odd
+//while it's being written, so readers read straight out of the mapping and check the version afterwards to know whether
+//the writer came round the ring and wrote over them while they were reading. Only available on POSIX platforms.
+
+const uint32_t FRAME_STREAM_MAGIC = 0x53504852;
+//Bumped whenever the layout changes, readers refuse any other version
+const uint32_t FRAME_STREAM_VERSION = 1;
+
+//Optional per sphere fields, positions, radii and ids are always written
+enum EStreamFields : uint32_t {
+	StreamVelocity = 1,
+	StreamHp = 2,
+};
+
+//Start of the shared memory, followed by numSlots slots of slotBytes each
+struct alignas(64) FrameStreamHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numSlots;
+	uint32_t fields;
+	//Most spheres a slot has room for
+	uint32_t capacity;
+	uint32_t padding;
+	uint64_t slotBytes;
+	//Sequence number of the last frame written, frames count up from 1 so 0 means none yet
+	std::atomic<uint64_t> latest;
+};
+
+//Start of each slot, followed by one array per field of capacity entries each, statics then dynamics
+struct alignas(64) FrameSlotHeader {
+	//Twice the sequence number of the frame in the slot, or one less while that frame is being written
+	std::atomic<uint64_t> version;
+	int32_t frame;
+	int32_t numStatics;
+	int32_t numDynamics;
+	uint32_t checksum;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The frame stream needs lock free 64 bit atomics to share them between processes");
+
+//One frame as it sits in shared memory, nothing is copied. Optional fields not in the stream are null.
+struct StreamFrame {
+	uint64_t sequence = 0;
+	int frame = 0;
+	int numStatics = 0;
+	int numDynamics = 0;
+	uint32_t checksum = 0;
+	const float* x = nullptr;
+	const float* y = nullptr;
+	const float* radius = nullptr;
+	const int32_t* id = nullptr;
+	const float* velocityX = nullptr;
+	const float* velocityY = nullptr;
+	const int32_t* hp = nullptr;
+};
+
+//Checksum the writer stores with each frame, over every field of every sphere in it.
+uint32_t StreamChecksum(const StreamFrame& frame);
+
+class CFrameStreamWriter
+{
+public:
+	//Creates the shared memory under name, replacing anything left there. fields is any EStreamFields.
+	//Returns nullptr if shared memory can't be created on this platform.
+	static CFrameStreamWriter* Create(const char* name, int capacity, int numSlots, uint32_t fields);
+	//Unlinks the name, readers already mapped keep what they have
+	~CFrameStreamWriter();
+	CFrameStreamWriter(const CFrameStreamWriter&) = delete;
+	CFrameStreamWriter& operator=(const CFrameStreamWriter&) = delete;
+
+	//Writes the spheres into the next slot and makes it the latest frame. Spheres past capacity are dropped.
+	void Write(int frame, const std::vector<CircleUpdateData*>& staticSpheres, const std::vector<CircleUpdateData*>& dynamicSpheres);
+
+private:
+	CFrameStreamWriter() {}
+
+	std::vector<char> name;
+	char* memory = nullptr;
+	size_t size = 0;
+	uint64_t sequence = 0;
+};
+
+class CFrameStreamReader
+{
+public:
+	//Maps a stream another process created read only, nullptr if there isn't one or its layout doesn't match.
+	static CFrameStreamReader* Open(const char* name);
+	~CFrameStreamReader();
+	CFrameStreamReader(const CFrameStreamReader&) = delete;
+	CFrameStreamReader& operator=(const CFrameStreamReader&) = delete;
+
+	//Points frame at the latest finished frame, false if nothing has been written yet.
+	bool Latest(StreamFrame& frame) const;
+	//Whether the frame's slot still holds it. Anything read from the frame before this returns true wasn't torn.
+	bool StillValid(const StreamFrame& frame) const;
+
+	int Capacity() const { return int(Header()->capacity); }
+	int NumSlots() const { return int(Header()->numSlots); }
+	uint32_t Fields() const { return Header()->fields; }
+
+private:
+	CFrameStreamReader() {}
+	const FrameStreamHeader* Header() const { return reinterpret_cast<const FrameStreamHeader*>(memory); }
+
+	const char* memory = nullptr;
+	size_t size = 0;
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include "Frustum.h"
+#include <algorithm>
+#include <cmath>
+
+CFrustum::CFrustum(vector3 Position, vector3 right, vector3 up, vector3 forward, float fovY, float aspect, float nearClip, float farClip) {
+	position = Position;
+	right = Normalise(right);
+	up = Normalise(up);
+	forward = Normalise(forward);
+
+	const float tanY = std::tan(fovY * 0.5f);
+	const float tanX = tanY * aspect;
+	const float clipDistances[2] = { nearClip, farClip };
+	const float cornerSigns[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+	for (int plane = 0; plane < 2; plane++) {
+		const float distance = clipDistances[plane];
+		for (int i = 0; i < 4; i++) {
+			corners[plane * 4 + i] = position + forward * distance + right * (cornerSigns[i][0] * distance * tanX) + up * (cornerSigns[i][1] * distance * tanY);
+		}
+	}
+
+	//Each plane is built from three corners and flipped if need be so the middle of the volume is on its inside,
+	//which saves caring which way round the engine's axes are handed
+	const vector3 inside = position + forward * ((nearClip + farClip) * 0.5f);
+	const int planeCorners[6][3] = { { 0, 1, 2 }, { 4, 5, 6 }, { 0, 1, 5 }, { 1, 2, 6 }, { 2, 3, 7 }, { 3, 0, 4 } };
+	for (int i = 0; i < 6; i++) {
+		const vector3 a = corners[planeCorners[i][0]];
+		const vector3 b = corners[planeCorners[i][1]];
+		const vector3 c = corners[planeCorners[i][2]];
+		Plane& plane = planes[i];
+		plane.normal = Normalise(Cross(b - a, c - a));
+		plane.distance = -Dot(plane.normal, a);
+		if (Dot(plane.normal, inside) + plane.distance < 0.0f) {
+			plane.normal = -plane.normal;
+			plane.distance = -plane.distance;
+		}
+	}
+}
+
+bool CFrustum::Intersects(vector3 centre, float radius) const {
+	for (const auto& plane : planes) {
+		if (Dot(plane.normal, centre) + plane.distance < -radius) return false;
+	}
+	return true;
+}
+
+bool CFrustum::PlaneFootprint(float margin, vector2& min, vector2& max) const {
+	//The part of the volume within margin of the plane is a convex solid whose corners are either frustum corners inside
+	//that slab or frustum edges crossing its faces, so the bounds of those points bound all of it
+	const int edges[12][2] = { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 }, { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
+	bool bFound = false;
+	auto include = [&](float x, float y) {
+		if (!bFound) {
+			min = { x, y };
+			max = { x, y };
+			bFound = true;
+			return;
+		}
+		min = { std::min(min.x, x), std::min(min.y, y) };
+		max = { std::max(max.x, x), std::max(max.y, y) };
+	};
+
+	for (const auto& corner : corners) {
+		if (std::abs(corner.z) <= margin) include(corner.x, corner.y);
+	}
+	for (const float z : { -margin, margin }) {
+		for (const auto& edge : edges) {
+			const vector3 a = corners[edge[0]];
+			const vector3 b = corners[edge[1]];
+			if ((a.z - z) * (b.z - z) > 0.0f || a.z == b.z) continue;
+			const float t = (z - a.z) / (b.z - a.z);
+			include(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
+		}
+	}
+	if (!bFound) return false;
+
+	min = min - vector2{ margin, margin };
+	max = max + vector2{ margin, margin };
+	return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "SphereData.h"
+
+//View volume of a perspective camera, six inward facing planes plus the corners they meet at.
+//Engine agnostic, front ends build one from their camera's world matrix each frame.
+class CFrustum
+{
+public:
+	//Axes are the camera's world space right, up and forward directions. fovY is the vertical field of view in radians.
+	CFrustum(vector3 position, vector3 right, vector3 up, vector3 forward, float fovY, float aspect, float nearClip, float farClip);
+
+	bool Intersects(vector3 centre, float radius) const;
+	//Bounds of where the volume crosses the z = 0 plane the spheres live on, grown by margin so anything within margin of
+	//the volume lands inside. False when the volume doesn't come within margin of the plane.
+	bool PlaneFootprint(float margin, vector2& min, vector2& max) const;
+
+	vector3 Position() const { return position; }
+
+private:
+	struct Plane {
+		vector3 normal;
+		float distance;
+	};
+
+	vector3 position;
+	//Near plane corners then far plane corners, each going round the same way
+	vector3 corners[8];
+	Plane planes[6];
+};
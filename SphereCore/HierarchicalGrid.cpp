@@ -0,0 +1,152 @@
+#pragma once
+#include "HierarchicalGrid.h"
+#include <algorithm>
+
+//Slices are never smaller than this, below it a thread spends longer taking the task than doing it
+const int MIN_GRID_SLICE = 1024;
+//Each level's cells are this many times as wide as the one below's. Fewer levels make a query cheaper, more keep a level's
+//spheres closer to its cell size.
+const float GRID_LEVEL_SCALE = 4.0f;
+//Bits of a sort key per cell coordinate, the level goes above both
+const int GRID_COORD_BITS = 30;
+//A level only gets a row directory if it'd have no more than this many rows per cell, past the minimum
+const int MAX_ROWS_PER_CELL = 16;
+const int MIN_ROW_DIRECTORY = 1024;
+
+//Every slice finds its radius range, then keys and sorts its statics by level and cell. Sorted slices are merged in pairs
+//up a tree, and once the whole array is in order each level indexes its own cells while the slices pack the statics.
+void CHierarchicalGrid::PlanBuild(const std::vector<CircleUpdateData*>& Statics, int NumSlices, CTaskGraph& graph) {
+	statics = &Statics;
+	const int numStatics = int(Statics.size());
+	numSlices = std::max(1, std::min(NumSlices, numStatics / MIN_GRID_SLICE));
+	sliceMinRadii.assign(numSlices, INFINITY);
+	sliceMaxRadii.assign(numSlices, 0.0f);
+	entries.resize(numStatics);
+	x.resize(numStatics);
+	y.resize(numStatics);
+	radius.resize(numStatics);
+	index.resize(numStatics);
+	merges.clear();
+
+	graph.Clear();
+	std::vector<int> ranges(numSlices);
+	std::vector<int> keys(numSlices);
+	//Task that last wrote each stretch of entries, indexed by the slice the stretch starts at
+	std::vector<int> producers(numSlices);
+	for (int slice = 0; slice < numSlices; slice++) ranges.at(slice) = graph.Add(RangeStage, slice);
+	for (int slice = 0; slice < numSlices; slice++) {
+		keys.at(slice) = graph.Add(KeyStage, slice);
+		for (int range : ranges) graph.Depend(keys.at(slice), range);
+		producers.at(slice) = graph.Add(SortStage, slice);
+		graph.Depend(producers.at(slice), keys.at(slice));
+	}
+	for (int width = 1; width < numSlices; width *= 2) {
+		for (int slice = 0; slice + width < numSlices; slice += 2 * width) {
+			merges.push_back({ SliceStart(slice), SliceStart(slice + width), SliceStart(std::min(slice + 2 * width, numSlices)) });
+			const int merge = graph.Add(MergeStage, int(merges.size()) - 1);
+			graph.Depend(merge, producers.at(slice));
+			graph.Depend(merge, producers.at(slice + width));
+			producers.at(slice) = merge;
+		}
+	}
+	for (int level = 0; level < MAX_GRID_LEVELS; level++) graph.Depend(graph.Add(CellStage, level), producers.at(0));
+	for (int slice = 0; slice < numSlices; slice++) graph.Depend(graph.Add(PackStage, slice), producers.at(0));
+}
+
+void CHierarchicalGrid::RunBuildTask(int stage, int task) {
+	const std::vector<CircleUpdateData*>& spheres = *statics;
+	const int begin = stage == CellStage || stage == MergeStage ? 0 : SliceStart(task);
+	const int end = stage == CellStage || stage == MergeStage ? 0 : SliceStart(task + 1);
+
+	switch (stage) {
+	case RangeStage:
+		for (int i = begin; i < end; i++) {
+			sliceMinRadii[task] = std::min(sliceMinRadii[task], spheres[i]->radius);
+			sliceMaxRadii[task] = std::max(sliceMaxRadii[task], spheres[i]->radius);
+		}
+		break;
+	case KeyStage: {
+		//Every slice works the same level count out from the ranges rather than waiting on one task to
+		const float smallest = std::max(*std::min_element(sliceMinRadii.begin(), sliceMinRadii.end()), 1e-3f);
+		const float largest = *std::max_element(sliceMaxRadii.begin(), sliceMaxRadii.end());
+		if (task == 0) {
+			minRadius = smallest;
+			numLevels = 1;
+			for (float cellSize = 2.0f * smallest; cellSize < 2.0f * largest && numLevels < MAX_GRID_LEVELS; cellSize *= GRID_LEVEL_SCALE) numLevels++;
+		}
+		for (int i = begin; i < end; i++) {
+			int level = 0;
+			float cellSize = 2.0f * smallest;
+			for (; cellSize < 2.0f * spheres[i]->radius && level < MAX_GRID_LEVELS - 1; cellSize *= GRID_LEVEL_SCALE) level++;
+			const double inverseCellSize = 1.0 / cellSize;
+			const uint64_t cellX = uint64_t(Coord(spheres[i]->pos.x, inverseCellSize) + (1 << 29));
+			const uint64_t cellY = uint64_t(Coord(spheres[i]->pos.y, inverseCellSize) + (1 << 29));
+			entries[i] = { uint64_t(level) << (2 * GRID_COORD_BITS) | cellY << GRID_COORD_BITS | cellX, i };
+		}
+		break;
+	}
+	case SortStage:
+		std::sort(entries.begin() + begin, entries.begin() + end);
+		break;
+	case MergeStage: {
+		const Merge& merge = merges[task];
+		std::inplace_merge(entries.begin() + merge.begin, entries.begin() + merge.middle, entries.begin() + merge.end);
+		break;
+	}
+	case CellStage: {
+		Level& level = levels[task];
+		level.cells.clear();
+		level.rowStarts.clear();
+		level.maxRadius = 0.0f;
+		level.cellSize = 2.0f * minRadius;
+		for (int l = 0; l < task; l++) level.cellSize *= GRID_LEVEL_SCALE;
+		level.inverseCellSize = 1.0 / level.cellSize;
+		if (task >= numLevels) break;
+
+		const uint64_t levelKey = uint64_t(task) << (2 * GRID_COORD_BITS);
+		auto first = std::lower_bound(entries.begin(), entries.end(), Entry{ levelKey, 0 });
+		auto last = std::lower_bound(first, entries.end(), Entry{ levelKey + (uint64_t(1) << (2 * GRID_COORD_BITS)), 0 });
+		const uint64_t coordMask = (uint64_t(1) << GRID_COORD_BITS) - 1;
+		for (auto entry = first; entry != last; entry++) {
+			level.maxRadius = std::max(level.maxRadius, spheres[entry->index]->radius);
+			const int at = int(entry - entries.begin());
+			if (entry != first && entry->key == (entry - 1)->key) {
+				level.cells.back().end = at + 1;
+				continue;
+			}
+			level.cells.push_back({ int(entry->key & coordMask) - (1 << 29), int((entry->key >> GRID_COORD_BITS) & coordMask) - (1 << 29), at, at + 1 });
+		}
+
+		if (level.cells.empty()) break;
+		level.firstRow = level.cells.front().y;
+		const long long numRows = (long long)(level.cells.back().y) - level.firstRow + 1;
+		if (numRows > MAX_ROWS_PER_CELL * (long long)(level.cells.size()) + MIN_ROW_DIRECTORY) break;
+		level.rowStarts.assign(size_t(numRows) + 1, 0);
+		int cell = 0;
+		for (int row = 0; row <= int(numRows); row++) {
+			while (cell < int(level.cells.size()) && level.cells[cell].y < level.firstRow + row) cell++;
+			level.rowStarts[row] = cell;
+		}
+		break;
+	}
+	case PackStage:
+		for (int i = begin; i < end; i++) {
+			const CircleUpdateData* sphere = spheres[entries[i].index];
+			x[i] = sphere->pos.x;
+			y[i] = sphere->pos.y;
+			radius[i] = sphere->radius;
+			index[i] = entries[i].index;
+		}
+		break;
+	}
+}
+
+int CHierarchicalGrid::NumCells() const {
+	int cells = 0;
+	for (int l = 0; l < numLevels; l++) cells += int(levels[l].cells.size());
+	return cells;
+}
+
+int CHierarchicalGrid::SliceStart(int slice) const {
+	return int((long long)(slice) * statics->size() / numSlices);
+}
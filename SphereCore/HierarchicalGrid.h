@@ -0,0 +1,137 @@
+#pragma once
+#include "SphereData.h"
+#include "TaskGraph.h"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+//Most levels a grid has, far more than radii in a float world could span
+const int MAX_GRID_LEVELS = 16;
+
+//Static spheres binned into a stack of grids for worlds mixing tiny and huge spheres, where any one cell size or the x-sweep
+//fits neither. Level 0's cells are as wide as the smallest static, each level up widens them a few times over, and every
+//static goes in the lowest level with cells at least as wide as it. A query visits every level, each only as far as its own largest static
+//could reach, so small spheres never look through the big ones' cells and the reverse. Only occupied cells are stored, in
+//row order with a directory of where each row starts, so a query steps over empty space a row at a time rather than a cell.
+//Statics are copied in packed arrays cell by cell. Built once as statics never move, split into tasks for a task graph.
+class CHierarchicalGrid
+{
+public:
+	//Build tasks, run as execute(stage, index) in dependency order
+	enum EBuildStage { RangeStage, KeyStage, SortStage, MergeStage, CellStage, PackStage };
+
+	//Adds the tasks building the grid over statics to graph, split into about numSlices pieces for that many threads.
+	//statics must be sorted by x and stay as they are, the grid refers to them by index.
+	void PlanBuild(const std::vector<CircleUpdateData*>& statics, int numSlices, CTaskGraph& graph);
+	void RunBuildTask(int stage, int index);
+
+	//Calls visit(begin, end) with each range of packed statics in a cell that may hold one within reach of pos, reach
+	//being added to each level's largest radius
+	template <typename Visit>
+	void ForEachCell(vector2 pos, float reach, Visit visit) const;
+
+	//Packed statics, index is each one's position in the x-sorted statics
+	const float* X() const { return x.data(); }
+	const float* Y() const { return y.data(); }
+	const float* Radius() const { return radius.data(); }
+	const int* Index() const { return index.data(); }
+	int NumLevels() const { return numLevels; }
+	int NumCells() const;
+
+private:
+	struct Cell {
+		int x;
+		int y;
+		int begin;
+		int end;
+	};
+	struct Level {
+		float cellSize = 0.0f;
+		double inverseCellSize = 0.0;
+		float maxRadius = 0.0f;
+		//Sorted by y then x
+		std::vector<Cell> cells;
+		//Index of the first cell in each row from firstRow on, with the end last. Left empty where rows are spread so thinly
+		//that it'd be mostly empty, rows are binary searched for instead.
+		std::vector<int> rowStarts;
+		int firstRow = 0;
+	};
+	struct Entry {
+		uint64_t key;
+		int index;
+		bool operator<(const Entry& other) const { return key < other.key || (key == other.key && index < other.index); }
+	};
+	struct Merge {
+		int begin;
+		int middle;
+		int end;
+	};
+
+	static int Coord(float position, double inverseCellSize);
+	//First cell of the level in row or any row after it, searching from to to if there's no row directory
+	static int RowStart(const Level& level, int row, int from, int to);
+	int SliceStart(int slice) const;
+
+	const std::vector<CircleUpdateData*>* statics = nullptr;
+	int numSlices = 1;
+	std::vector<float> sliceMinRadii;
+	std::vector<float> sliceMaxRadii;
+	float minRadius = 0.0f;
+	int numLevels = 0;
+	std::vector<Entry> entries;
+	std::vector<Merge> merges;
+
+	Level levels[MAX_GRID_LEVELS];
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> radius;
+	std::vector<int> index;
+};
+
+template <typename Visit>
+void CHierarchicalGrid::ForEachCell(vector2 pos, float reach, Visit visit) const {
+	for (int l = 0; l < numLevels; l++) {
+		const Level& level = levels[l];
+		const Cell* cells = level.cells.data();
+		const int numCells = int(level.cells.size());
+		if (numCells == 0) continue;
+		const float levelReach = level.maxRadius + reach;
+		const int minX = Coord(pos.x - levelReach, level.inverseCellSize);
+		const int maxX = Coord(pos.x + levelReach, level.inverseCellSize);
+		const int minY = Coord(pos.y - levelReach, level.inverseCellSize);
+		const int maxY = Coord(pos.y + levelReach, level.inverseCellSize);
+
+		//The rows a query spans are one stretch of cells, walked skipping what's either side of it in each row
+		int c = RowStart(level, minY, 0, numCells);
+		const int last = RowStart(level, maxY + 1, c, numCells);
+		while (c < last) {
+			const Cell& cell = cells[c];
+			if (cell.x > maxX) c = RowStart(level, cell.y + 1, c, last);
+			else if (cell.x >= minX) {
+				visit(cell.begin, cell.end);
+				c++;
+			}
+			else {
+				const int rowEnd = RowStart(level, cell.y + 1, c, last);
+				c = int(std::lower_bound(cells + c, cells + rowEnd, minX, [](const Cell& cell, int x) { return cell.x < x; }) - cells);
+			}
+		}
+	}
+}
+
+inline int CHierarchicalGrid::Coord(float position, double inverseCellSize) {
+	//Kept inside 30 bits so a cell packs into a sort key, NaNs go to the lowest
+	const double coord = std::floor(double(position) * inverseCellSize);
+	if (!(coord > -double(1 << 29))) return -(1 << 29);
+	if (coord > double((1 << 29) - 1)) return (1 << 29) - 1;
+	return int(coord);
+}
+
+inline int CHierarchicalGrid::RowStart(const Level& level, int row, int from, int to) {
+	if (level.rowStarts.empty()) {
+		return int(std::lower_bound(level.cells.begin() + from, level.cells.begin() + to, row, [](const Cell& cell, int y) { return cell.y < y; }) - level.cells.begin());
+	}
+	const int offset = std::max(0, std::min(row - level.firstRow, int(level.rowStarts.size()) - 1));
+	return level.rowStarts[offset];
+}
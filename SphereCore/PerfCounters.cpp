@@ -0,0 +1,98 @@
+#pragma once
+#include "PerfCounters.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+CPerfCounters::~CPerfCounters() {
+#ifdef __linux__
+	for (int file : files) if (file >= 0) close(file);
+#endif
+}
+
+bool CPerfCounters::Open() {
+#ifdef __linux__
+	//Generic cache events are id | op << 8 | result << 16
+	auto cacheMiss = [](uint64_t cache) { return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16); };
+	const uint32_t types[NUM_PERF_COUNTERS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE,
+		PERF_TYPE_HW_CACHE, PERF_TYPE_SOFTWARE, PERF_TYPE_SOFTWARE };
+	const uint64_t configs[NUM_PERF_COUNTERS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, cacheMiss(PERF_COUNT_HW_CACHE_L1D),
+		cacheMiss(PERF_COUNT_HW_CACHE_LL), PERF_COUNT_HW_BRANCH_MISSES, cacheMiss(PERF_COUNT_HW_CACHE_DTLB), PERF_COUNT_SW_TASK_CLOCK,
+		PERF_COUNT_SW_CONTEXT_SWITCHES };
+
+	//Each counter is opened on its own rather than as a group, so more hardware counters than the PMU has take turns and are
+	//scaled up instead of the whole group never being scheduled
+	for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+		perf_event_attr attributes;
+		std::memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = types[i];
+		attributes.config = configs[i];
+		attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		//Switches happen in the kernel so only count with it included, which takes a perf_event_paranoid of 1 or root
+		attributes.exclude_kernel = i == PerfContextSwitches ? 0 : 1;
+		attributes.exclude_hv = 1;
+		files[i] = int(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+		if (files[i] >= 0) available |= 1u << i;
+	}
+#endif
+	return IsOpen();
+}
+
+void CPerfCounters::Read(PerfReading& reading) const {
+#ifdef __linux__
+	for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+		if (files[i] < 0) continue;
+		uint64_t values[3];
+		if (read(files[i], values, sizeof(values)) != ssize_t(sizeof(values))) continue;
+		reading.values[i] = values[0];
+		reading.enabled[i] = values[1];
+		reading.running[i] = values[2];
+	}
+#endif
+}
+
+void CPerfCounters::Lap(PerfReading& last, PerfTotals& totals) const {
+	PerfReading now;
+	Read(now);
+	for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+		const uint64_t running = now.running[i] - last.running[i];
+		//A counter that never got onto the PMU during the lap has nothing to scale up
+		if (running > 0) totals.counts[i] += double(now.values[i] - last.values[i]) * double(now.enabled[i] - last.enabled[i]) / double(running);
+	}
+	last = now;
+}
+
+void WritePerfLine(std::ostream& out, const char* name, const PerfTotals& totals, int numFrames, uint32_t available) {
+	if (numFrames <= 0) return;
+	auto has = [&](EPerfCounter counter) { return (available & (1u << counter)) != 0; };
+	auto perFrame = [&](EPerfCounter counter) { return totals.counts[counter] / numFrames; };
+	const char* separator = " ";
+	auto next = [&]() -> std::ostream& {
+		out << separator;
+		separator = ", ";
+		return out;
+	};
+
+	out << "  " << name << ":";
+	if (has(PerfCycles)) next() << perFrame(PerfCycles) / 1e6 << "M cycles";
+	if (has(PerfInstructions)) next() << perFrame(PerfInstructions) / 1e6 << "M instructions";
+	if (has(PerfCycles) && has(PerfInstructions) && totals.counts[PerfCycles] > 0.0) next() << totals.counts[PerfInstructions] / totals.counts[PerfCycles] << " IPC";
+
+	//Misses per thousand instructions compare across phases doing different amounts of work, per frame counts are the fallback
+	const EPerfCounter misses[4] = { PerfL1Misses, PerfLlcMisses, PerfBranchMisses, PerfTlbMisses };
+	const char* missNames[4] = { "L1", "LLC", "branch", "TLB" };
+	const bool bPerInstruction = has(PerfInstructions) && totals.counts[PerfInstructions] > 0.0;
+	for (int i = 0; i < 4; i++) {
+		if (!has(misses[i])) continue;
+		if (bPerInstruction) next() << totals.counts[misses[i]] * 1000.0 / totals.counts[PerfInstructions] << " " << missNames[i] << " misses per 1k instructions";
+		else next() << perFrame(misses[i]) << " " << missNames[i] << " misses";
+	}
+
+	if (has(PerfTaskClock)) next() << perFrame(PerfTaskClock) / 1e6 << "ms on cpu";
+	if (has(PerfContextSwitches)) next() << perFrame(PerfContextSwitches) << " context switches";
+	out << "\n";
+}
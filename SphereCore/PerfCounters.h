@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+
+//Hardware performance counters for the calling thread, through perf_event_open on Linux. They show whether a phase is held
+//up by cache and TLB misses, branch mispredicts or plain instruction throughput, where a frame time only shows it was slow.
+//Only user space is counted, which a perf_event_paranoid of 2 or lower allows for a process's own threads, apart from context
+//switches. Counters the CPU or kernel won't give, such as every hardware counter in most virtual machines, are left out.
+//Nothing opens on other platforms.
+
+enum EPerfCounter {
+	PerfCycles,
+	PerfInstructions,
+	PerfL1Misses,
+	PerfLlcMisses,
+	PerfBranchMisses,
+	PerfTlbMisses,
+	//Kept by the kernel so there even without a PMU
+	PerfTaskClock,
+	PerfContextSwitches,
+	NUM_PERF_COUNTERS
+};
+
+//Every counter's running total at one moment
+struct PerfReading {
+	uint64_t values[NUM_PERF_COUNTERS] = {};
+	uint64_t enabled[NUM_PERF_COUNTERS] = {};
+	uint64_t running[NUM_PERF_COUNTERS] = {};
+};
+
+//Counts added up over any number of stretches of code, scaled up for time a counter spent multiplexed off the PMU
+struct PerfTotals {
+	double counts[NUM_PERF_COUNTERS] = {};
+};
+
+class CPerfCounters
+{
+public:
+	CPerfCounters() {}
+	~CPerfCounters();
+	CPerfCounters(const CPerfCounters&) = delete;
+	CPerfCounters& operator=(const CPerfCounters&) = delete;
+
+	//Opens every counter it can for the calling thread, the only thread they count. False if none would open.
+	bool Open();
+	bool IsOpen() const { return available != 0; }
+	//A bit per EPerfCounter that opened
+	uint32_t Available() const { return available; }
+
+	void Read(PerfReading& reading) const;
+	//Adds everything counted since last to totals and moves last on to now, so back to back laps cover neighbouring stretches
+	void Lap(PerfReading& last, PerfTotals& totals) const;
+
+private:
+	int files[NUM_PERF_COUNTERS] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+	uint32_t available = 0;
+};
+
+//One line of per frame counts for a phase or thread, with instructions per cycle and misses per thousand instructions.
+//Counters missing from available are left off.
+void WritePerfLine(std::ostream& out, const char* name, const PerfTotals& totals, int numFrames, uint32_t available);
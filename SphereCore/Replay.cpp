@@ -0,0 +1,342 @@
+#pragma once
+#include "Replay.h"
+#include <cmath>
+
+//File layout, all values in the recording machine's byte order:
+//	header		magic, version, numStatics, numDynamics, ReplaySettings
+//	statics		x, y, radius and id of each
+//	dynamics	radius of each by id
+//	frames		payload bytes, frame number and step, then the payload
+//	index		offset of every frame, the frame count and the index magic, only there if the recorder finished
+const uint32_t REPLAY_MAGIC = 0x50525053;
+const uint32_t REPLAY_INDEX_MAGIC = 0x58495053;
+const uint32_t REPLAY_VERSION = 1;
+
+//Channels of each frame, in the order they're stored
+enum EReplayChannel { PositionX, PositionY, VelocityX, VelocityY };
+
+struct ReplayHeader {
+	uint32_t magic;
+	uint32_t version;
+	int32_t numStatics;
+	int32_t numDynamics;
+	int32_t keyframeInterval;
+	float positionStep;
+	float velocityStep;
+};
+struct ReplayStatic {
+	float x, y, radius;
+	int32_t id;
+};
+struct ReplayRecord {
+	uint32_t payloadBytes;
+	int32_t frame;
+	float step;
+};
+
+//Where a sphere would be if nothing hit it, the recorder and player must agree on this exactly
+static int32_t PredictPosition(int32_t position, int32_t velocity, float step, const ReplaySettings& settings) {
+	return position + int32_t(std::lround(float(velocity) * settings.velocityStep * step / settings.positionStep));
+}
+
+static void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+	while (value >= 0x80) {
+		out.emplace_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	out.emplace_back(uint8_t(value));
+}
+
+static bool GetVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+	value = 0;
+	for (int shift = 0; shift < 64 && in != end; shift += 7) {
+		const uint8_t byte = *in++;
+		value |= uint64_t(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+//Each token's low bit says whether it's a run of zeros or one zigzagged value
+static void PutResiduals(std::vector<uint8_t>& out, const int32_t* residuals, int count) {
+	int zeros = 0;
+	for (int i = 0; i < count; i++) {
+		if (residuals[i] == 0) {
+			zeros++;
+			continue;
+		}
+		if (zeros > 0) PutVarint(out, (uint64_t(zeros - 1) << 1) | 1);
+		zeros = 0;
+		const int64_t value = residuals[i];
+		const uint64_t zigzag = (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+		PutVarint(out, zigzag << 1);
+	}
+	if (zeros > 0) PutVarint(out, (uint64_t(zeros - 1) << 1) | 1);
+}
+
+static bool GetResiduals(const uint8_t*& in, const uint8_t* end, int32_t* residuals, int count) {
+	int i = 0;
+	while (i < count) {
+		uint64_t token;
+		if (!GetVarint(in, end, token)) return false;
+		if (token & 1) {
+			const uint64_t zeros = (token >> 1) + 1;
+			if (zeros > uint64_t(count - i)) return false;
+			for (uint64_t j = 0; j < zeros; j++) residuals[i++] = 0;
+		}
+		else {
+			const uint64_t zigzag = token >> 1;
+			residuals[i++] = int32_t(int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1));
+		}
+	}
+	return true;
+}
+
+CReplayRecorder::CReplayRecorder(const ReplaySettings& Settings, int NumDynamics) : settings(Settings), numDynamics(NumDynamics) {
+	for (auto& capture : captures) {
+		for (auto& channel : capture.channels) channel.resize(numDynamics, 0.0f);
+	}
+	for (auto& channel : previous) channel.resize(numDynamics, 0);
+	residuals.resize(numDynamics, 0);
+	//Enough for an hour at 60 frames a second before the index ever regrows
+	frameOffsets.reserve(60 * 60 * 60);
+}
+
+CReplayRecorder* CReplayRecorder::Create(const char* path, const ReplaySettings& settings, const std::vector<CircleUpdateData*>& staticSpheres, const std::vector<CircleUpdateData*>& dynamicSpheres) {
+	CReplayRecorder* recorder = new CReplayRecorder(settings, int(dynamicSpheres.size()));
+	recorder->file.open(path, std::ios::binary | std::ios::trunc);
+	if (!recorder->file) {
+		delete recorder;
+		return nullptr;
+	}
+
+	const ReplayHeader header = { REPLAY_MAGIC, REPLAY_VERSION, int32_t(staticSpheres.size()), int32_t(dynamicSpheres.size()), settings.keyframeInterval, settings.positionStep, settings.velocityStep };
+	recorder->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (auto sphere : staticSpheres) {
+		const ReplayStatic record = { sphere->pos.x, sphere->pos.y, sphere->radius, sphere->id };
+		recorder->file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	}
+	std::vector<float> radii(dynamicSpheres.size(), 0.0f);
+	for (auto sphere : dynamicSpheres) radii.at(sphere->id) = sphere->radius;
+	recorder->file.write(reinterpret_cast<const char*>(radii.data()), radii.size() * sizeof(float));
+	recorder->bytesWritten.store(sizeof(header) + staticSpheres.size() * sizeof(ReplayStatic) + radii.size() * sizeof(float), std::memory_order_relaxed);
+
+	recorder->writer = std::thread(&CReplayRecorder::WriterLoop, recorder);
+	recorder->Record(0, 0.0f, dynamicSpheres);
+	return recorder;
+}
+
+CReplayRecorder::~CReplayRecorder() {
+	if (writer.joinable()) {
+		{
+			std::unique_lock<std::mutex> lock(captureLock);
+			bStopping = true;
+		}
+		captureReady.notify_one();
+		writer.join();
+
+		file.write(reinterpret_cast<const char*>(frameOffsets.data()), frameOffsets.size() * sizeof(uint64_t));
+		const uint32_t footer[2] = { uint32_t(frameOffsets.size()), REPLAY_INDEX_MAGIC };
+		file.write(reinterpret_cast<const char*>(footer), sizeof(footer));
+	}
+}
+
+void CReplayRecorder::Record(int frame, float step, const std::vector<CircleUpdateData*>& dynamicSpheres) {
+	int slot;
+	{
+		std::unique_lock<std::mutex> lock(captureLock);
+		captureFree.wait(lock, [&]() { return captured - written < NUM_CAPTURES; });
+		slot = captured % NUM_CAPTURES;
+	}
+
+	//The writer never touches a capture between it being freed and handed back
+	Capture& capture = captures[slot];
+	capture.frame = frame;
+	capture.step = step;
+	for (auto sphere : dynamicSpheres) {
+		if (sphere->id < 0 || sphere->id >= numDynamics) continue;
+		capture.channels[PositionX][sphere->id] = sphere->pos.x;
+		capture.channels[PositionY][sphere->id] = sphere->pos.y;
+		capture.channels[VelocityX][sphere->id] = sphere->velocity.x;
+		capture.channels[VelocityY][sphere->id] = sphere->velocity.y;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(captureLock);
+		captured++;
+	}
+	captureReady.notify_one();
+}
+
+void CReplayRecorder::WriterLoop() {
+	while (true) {
+		int slot;
+		{
+			std::unique_lock<std::mutex> lock(captureLock);
+			captureReady.wait(lock, [&]() { return written < captured || bStopping; });
+			//Everything queued is written before stopping
+			if (written == captured) return;
+			slot = written % NUM_CAPTURES;
+		}
+
+		Encode(captures[slot]);
+
+		{
+			std::unique_lock<std::mutex> lock(captureLock);
+			written++;
+		}
+		captureFree.notify_one();
+	}
+}
+
+void CReplayRecorder::Encode(const Capture& capture) {
+	const bool bKeyframe = frameOffsets.size() % settings.keyframeInterval == 0;
+	const float steps[4] = { settings.positionStep, settings.positionStep, settings.velocityStep, settings.velocityStep };
+
+	//previous holds what the player will have decoded, not the true values, so positions can run on their prediction while
+	//it stays within a step of the truth. Rounding every frame would leave a one step residual on most spheres.
+	encoded.clear();
+	for (int channel = 0; channel < 4; channel++) {
+		const bool bPosition = channel == PositionX || channel == PositionY;
+		for (int i = 0; i < numDynamics; i++) {
+			const float exact = capture.channels[channel][i] / steps[channel];
+			int32_t value = int32_t(std::lround(exact));
+			int32_t predicted = 0;
+			if (!bKeyframe) {
+				//Velocities come after positions so last frame's are still there to predict from
+				predicted = bPosition ? PredictPosition(previous[channel][i], previous[channel + 2][i], capture.step, settings) : previous[channel][i];
+				if (bPosition && std::abs(exact - float(predicted)) <= 1.0f) value = predicted;
+			}
+			residuals[i] = value - predicted;
+			previous[channel][i] = value;
+		}
+		PutResiduals(encoded, residuals.data(), numDynamics);
+	}
+
+	const ReplayRecord record = { uint32_t(encoded.size()), capture.frame, capture.step };
+	const uint64_t offset = bytesWritten.load(std::memory_order_relaxed);
+	frameOffsets.emplace_back(offset);
+	file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+	bytesWritten.store(offset + sizeof(record) + encoded.size(), std::memory_order_relaxed);
+}
+
+CReplayPlayer* CReplayPlayer::Open(const char* path) {
+	CReplayPlayer* player = new CReplayPlayer();
+	std::ifstream& file = player->file;
+	file.open(path, std::ios::binary);
+	ReplayHeader header;
+	if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION
+		|| header.numStatics < 0 || header.numDynamics < 0 || header.keyframeInterval < 1) {
+		delete player;
+		return nullptr;
+	}
+	player->settings.keyframeInterval = header.keyframeInterval;
+	player->settings.positionStep = header.positionStep;
+	player->settings.velocityStep = header.velocityStep;
+
+	std::vector<ReplayStatic> statics(header.numStatics);
+	std::vector<float> radii(header.numDynamics);
+	file.read(reinterpret_cast<char*>(statics.data()), statics.size() * sizeof(ReplayStatic));
+	file.read(reinterpret_cast<char*>(radii.data()), radii.size() * sizeof(float));
+	if (!file) {
+		delete player;
+		return nullptr;
+	}
+	for (auto& record : statics) {
+		CircleUpdateData sphere;
+		sphere.pos = { record.x, record.y };
+		sphere.radius = record.radius;
+		sphere.id = record.id;
+		player->statics.emplace_back(sphere);
+	}
+	player->dynamics.resize(header.numDynamics);
+	for (int i = 0; i < header.numDynamics; i++) {
+		player->dynamics.at(i).radius = radii.at(i);
+		player->dynamics.at(i).id = i;
+	}
+	for (auto& channel : player->quantized) channel.resize(header.numDynamics, 0);
+	player->residuals.resize(header.numDynamics, 0);
+	const uint64_t framesStart = uint64_t(file.tellg());
+
+	//The index at the end is trusted if its magic and count fit the file, otherwise the records are walked
+	file.seekg(0, std::ios::end);
+	const uint64_t fileSize = uint64_t(file.tellg());
+	uint32_t footer[2] = { 0, 0 };
+	if (fileSize >= framesStart + sizeof(footer)) {
+		file.seekg(fileSize - sizeof(footer));
+		file.read(reinterpret_cast<char*>(footer), sizeof(footer));
+	}
+	const uint64_t indexBytes = uint64_t(footer[0]) * sizeof(uint64_t) + sizeof(footer);
+	if (file && footer[1] == REPLAY_INDEX_MAGIC && indexBytes <= fileSize - framesStart) {
+		player->frameOffsets.resize(footer[0]);
+		file.seekg(fileSize - indexBytes);
+		file.read(reinterpret_cast<char*>(player->frameOffsets.data()), footer[0] * sizeof(uint64_t));
+	}
+	else {
+		file.clear();
+		uint64_t offset = framesStart;
+		ReplayRecord record;
+		while (offset + sizeof(record) <= fileSize) {
+			file.seekg(offset);
+			if (!file.read(reinterpret_cast<char*>(&record), sizeof(record))) break;
+			if (offset + sizeof(record) + record.payloadBytes > fileSize) break;
+			player->frameOffsets.emplace_back(offset);
+			offset += sizeof(record) + record.payloadBytes;
+		}
+	}
+	file.clear();
+	return player;
+}
+
+bool CReplayPlayer::Seek(int index) {
+	if (index < 0 || index >= NumFrames()) return false;
+	if (index == current) return true;
+
+	//Carries on from the current frame when it's between the keyframe and the target, otherwise starts at the keyframe
+	const int keyframe = index - index % settings.keyframeInterval;
+	const int first = current >= keyframe && current < index ? current + 1 : keyframe;
+	for (int i = first; i <= index; i++) {
+		if (!DecodeRecord(i)) {
+			current = -1;
+			return false;
+		}
+	}
+
+	const float steps[4] = { settings.positionStep, settings.positionStep, settings.velocityStep, settings.velocityStep };
+	for (int i = 0; i < int(dynamics.size()); i++) {
+		dynamics[i].pos = { quantized[PositionX][i] * steps[PositionX], quantized[PositionY][i] * steps[PositionY] };
+		dynamics[i].velocity = { quantized[VelocityX][i] * steps[VelocityX], quantized[VelocityY][i] * steps[VelocityY] };
+	}
+	return true;
+}
+
+bool CReplayPlayer::DecodeRecord(int index) {
+	ReplayRecord record;
+	file.seekg(frameOffsets.at(index));
+	if (!file.read(reinterpret_cast<char*>(&record), sizeof(record))) return false;
+	encoded.resize(record.payloadBytes);
+	if (!file.read(reinterpret_cast<char*>(encoded.data()), record.payloadBytes)) return false;
+
+	const bool bKeyframe = index % settings.keyframeInterval == 0;
+	const int numDynamics = int(dynamics.size());
+	const uint8_t* in = encoded.data();
+	const uint8_t* end = in + encoded.size();
+	//Positions are corrected first so they still see last frame's velocities
+	for (int channel = 0; channel < 4; channel++) {
+		std::vector<int32_t>& values = quantized[channel];
+		if (bKeyframe) {
+			if (!GetResiduals(in, end, values.data(), numDynamics)) return false;
+			continue;
+		}
+		if (!GetResiduals(in, end, residuals.data(), numDynamics)) return false;
+		for (int i = 0; i < numDynamics; i++) {
+			if (channel == PositionX || channel == PositionY) values[i] = PredictPosition(values[i], quantized[channel + 2][i], record.step, settings) + residuals[i];
+			else values[i] += residuals[i];
+		}
+	}
+
+	current = index;
+	frame = record.frame;
+	return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "SphereData.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+//Replay files hold the statics once and then every frame of the dynamics, as a keyframe every keyframeInterval frames and
+//deltas in between. Positions and velocities are quantized to fixed steps. A delta predicts each position from the last
+//frame's position and velocity, so only collisions, bounds and drift of more than a step leave anything to store. Played
+//back positions are within one positionStep of the truth and velocities within half a velocityStep. What's left is
+//written as zigzag varints with runs of zeros collapsed, planar so each channel's runs stay long.
+
+//How finely a replay is quantized, recorded in the file so players always decode with the recorder's settings
+struct ReplaySettings {
+	int keyframeInterval = 60;
+	float positionStep = 1.0f / 64.0f;
+	float velocityStep = 1.0f / 1024.0f;
+};
+
+//Records dynamics each frame. The simulation thread only gathers positions and velocities into a spare buffer, a
+//background thread quantizes, encodes and writes them. The simulation only waits if the writer falls a whole ring behind.
+class CReplayRecorder
+{
+public:
+	//Writes the file header and frame 0. Dynamic ids must run from 0 to one less than the number of dynamics.
+	//Returns nullptr if the file can't be opened.
+	static CReplayRecorder* Create(const char* path, const ReplaySettings& settings, const std::vector<CircleUpdateData*>& staticSpheres, const std::vector<CircleUpdateData*>& dynamicSpheres);
+	//Writes every frame still queued and the frame index
+	~CReplayRecorder();
+	CReplayRecorder(const CReplayRecorder&) = delete;
+	CReplayRecorder& operator=(const CReplayRecorder&) = delete;
+
+	//step is how far the frame moved spheres, in frames of velocity
+	void Record(int frame, float step, const std::vector<CircleUpdateData*>& dynamicSpheres);
+
+	//Encoded bytes handed to the file so far, header included. Safe to call while the writer runs, it may be a frame behind.
+	uint64_t BytesWritten() const { return bytesWritten.load(std::memory_order_relaxed); }
+
+private:
+	//Dynamics as they were at the end of one frame, indexed by id
+	struct Capture {
+		int frame = 0;
+		float step = 0.0f;
+		std::vector<float> channels[4];
+	};
+	static const int NUM_CAPTURES = 4;
+
+	CReplayRecorder(const ReplaySettings& settings, int numDynamics);
+	void WriterLoop();
+	void Encode(const Capture& capture);
+
+	ReplaySettings settings;
+	int numDynamics = 0;
+	std::ofstream file;
+	//Only the writer thread changes it once recording starts
+	std::atomic<uint64_t> bytesWritten{ 0 };
+
+	std::mutex captureLock;
+	std::condition_variable captureReady;
+	std::condition_variable captureFree;
+	Capture captures[NUM_CAPTURES];
+	//Captures handed out to the simulation and taken back by the writer, under captureLock
+	int captured = 0;
+	int written = 0;
+	bool bStopping = false;
+	std::thread writer;
+
+	//Writer thread only
+	//Last frame's quantized values, what the next frame is predicted from
+	std::vector<int32_t> previous[4];
+	std::vector<int32_t> residuals;
+	std::vector<uint8_t> encoded;
+	std::vector<uint64_t> frameOffsets;
+};
+
+//Reads a replay back. Seeking decodes the keyframe at or before the frame and the deltas after it.
+class CReplayPlayer
+{
+public:
+	//Returns nullptr if the file isn't a replay. A file cut short by a run that never finished is read up to its last whole frame.
+	static CReplayPlayer* Open(const char* path);
+
+	//Frames are numbered by their place in the recording, 0 being the world as generated
+	int NumFrames() const { return int(frameOffsets.size()); }
+	//Decodes a frame, moving straight on if it's the one after the current frame. False if it's out of range or damaged.
+	bool Seek(int index);
+	bool Next() { return Seek(current + 1); }
+
+	int Current() const { return current; }
+	//Simulation frame number of the current frame
+	int Frame() const { return frame; }
+	const ReplaySettings& Settings() const { return settings; }
+	//Statics never move, dynamics are indexed by id
+	const std::vector<CircleUpdateData>& Statics() const { return statics; }
+	const std::vector<CircleUpdateData>& Dynamics() const { return dynamics; }
+
+private:
+	CReplayPlayer() {}
+	bool DecodeRecord(int index);
+
+	std::ifstream file;
+	ReplaySettings settings;
+	std::vector<CircleUpdateData> statics;
+	std::vector<CircleUpdateData> dynamics;
+	//Where each frame's record starts, found from the index at the end of the file or by walking the records
+	std::vector<uint64_t> frameOffsets;
+	std::vector<int32_t> quantized[4];
+	std::vector<int32_t> residuals;
+	std::vector<uint8_t> encoded;
+	int current = -1;
+	int frame = 0;
+};
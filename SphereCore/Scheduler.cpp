@@ -0,0 +1,175 @@
+#pragma once
+#include "Scheduler.h"
+#include <algorithm>
+#include <cmath>
+
+//Weight kept from older frames, roughly a 50 frame memory
+const double FORGET = 0.98;
+//Budget is targeted with some headroom for the rest of the frame
+const float BUDGET_HEADROOM = 0.8f;
+//Every so often a neighbouring thread count is tried so the model sees more than one point
+const int EXPLORE_INTERVAL = 16;
+const int MAX_CHUNKS_PER_THREAD = 16;
+//Chunks smaller than this cost more in stealing and cache misses than they save in balance
+const int MIN_CHUNK_SPHERES = 256;
+
+void CFrameScheduler::Reset(int MaxWorkers, float FrameBudget)
+{
+	maxWorkers = MaxWorkers;
+	frameBudget = FrameBudget;
+	frame = 0;
+	chunksPerThread = 1;
+	for (int i = 0; i < NUM_TERMS; i++) {
+		for (int j = 0; j < NUM_TERMS; j++) sumXX[i][j] = 0.0;
+		sumXY[i] = 0.0;
+	}
+	bFitted = false;
+	workerCounts.assign(maxWorkers + 1, 0);
+	chunkCounts.assign(MAX_CHUNKS_PER_THREAD + 1, 0);
+	totalPhaseTime = 0.0;
+	totalImbalance = 0.0;
+	reportFrames = 0;
+	overBudgetFrames = 0;
+}
+
+float CFrameScheduler::Predict(int numThreads, int numSpheres) const
+{
+	return sphereCost * float(numSpheres) / numThreads + threadCost * numThreads + serialCost * float(numSpheres);
+}
+
+ScheduleDecision CFrameScheduler::Plan(int numSpheres)
+{
+	ScheduleDecision decision;
+	frame++;
+
+	//Until there's a model every thread is used, which also gives the fit its first points
+	if (!bFitted) decision.activeWorkers = maxWorkers;
+	else {
+		const float target = frameBudget * BUDGET_HEADROOM;
+		//Another worker has to win by a clear margin to be woken
+		int best = 0;
+		float bestPredicted = Predict(1, numSpheres);
+		int cheapestInBudget = bestPredicted <= target ? 0 : -1;
+		for (int workers = 1; workers <= maxWorkers; workers++) {
+			const float predicted = Predict(workers + 1, numSpheres);
+			if (predicted < bestPredicted * 0.99f) {
+				best = workers;
+				bestPredicted = predicted;
+			}
+			if (cheapestInBudget < 0 && predicted <= target) cheapestInBudget = workers;
+		}
+		decision.activeWorkers = cheapestInBudget >= 0 ? cheapestInBudget : best;
+
+		if (frame % EXPLORE_INTERVAL == 0) {
+			const int step = (frame / EXPLORE_INTERVAL) % 2 ? 1 : -1;
+			decision.activeWorkers = std::max(0, std::min(maxWorkers, decision.activeWorkers + step));
+		}
+	}
+
+	//Never split finer than the minimum chunk size
+	const int threads = decision.activeWorkers + 1;
+	int chunks = chunksPerThread;
+	while (chunks > 1 && numSpheres / (threads * chunks) < MIN_CHUNK_SPHERES) chunks /= 2;
+	decision.chunksPerThread = chunks;
+	decision.predictedTime = bFitted ? Predict(threads, numSpheres) : 0.0f;
+	return decision;
+}
+
+void CFrameScheduler::Record(const ScheduleDecision& decision, int numSpheres, float phaseTime, const std::vector<float>& busyTimes)
+{
+	const int threads = decision.activeWorkers + 1;
+	const double x[NUM_TERMS] = { double(numSpheres) / threads, double(threads), double(numSpheres) };
+	for (int i = 0; i < NUM_TERMS; i++) {
+		for (int j = 0; j < NUM_TERMS; j++) sumXX[i][j] = sumXX[i][j] * FORGET + x[i] * x[j];
+		sumXY[i] = sumXY[i] * FORGET + x[i] * phaseTime;
+	}
+	Solve();
+
+	//Granularity follows load imbalance, finer chunks when one thread holds everyone up, coarser when it doesn't
+	float maxBusy = 0.0f;
+	float totalBusy = 0.0f;
+	for (int i = 0; i < threads && i < int(busyTimes.size()); i++) {
+		maxBusy = std::max(maxBusy, busyTimes.at(i));
+		totalBusy += busyTimes.at(i);
+	}
+	const float imbalance = totalBusy > 0.0f ? maxBusy * threads / totalBusy : 1.0f;
+	if (threads > 1) {
+		if (imbalance > 1.15f && chunksPerThread < MAX_CHUNKS_PER_THREAD) chunksPerThread *= 2;
+		else if (imbalance < 1.05f && chunksPerThread > 1) chunksPerThread /= 2;
+	}
+
+	workerCounts.at(decision.activeWorkers)++;
+	chunkCounts.at(decision.chunksPerThread)++;
+	totalPhaseTime += phaseTime;
+	totalImbalance += imbalance;
+	reportFrames++;
+	if (phaseTime > frameBudget) overBudgetFrames++;
+	lastSpheres = numSpheres;
+}
+
+void CFrameScheduler::Solve()
+{
+	//Costs can't be negative, any term that fits negative is dropped and the rest refitted
+	bool bUsed[NUM_TERMS] = { true, true, true };
+	double costs[NUM_TERMS] = {};
+	for (int attempt = 0; attempt < NUM_TERMS; attempt++) {
+		//Normal equations for the terms still in use, a small ridge keeps them solvable before the thread count has varied
+		double a[NUM_TERMS][NUM_TERMS + 1] = {};
+		double trace = 0.0;
+		for (int i = 0; i < NUM_TERMS; i++) trace += sumXX[i][i];
+		for (int i = 0; i < NUM_TERMS; i++) {
+			for (int j = 0; j < NUM_TERMS; j++) a[i][j] = (bUsed[i] && bUsed[j]) ? sumXX[i][j] : 0.0;
+			a[i][i] = bUsed[i] ? a[i][i] + 1e-9 * trace + 1e-12 : 1.0;
+			a[i][NUM_TERMS] = bUsed[i] ? sumXY[i] : 0.0;
+		}
+
+		//Gaussian elimination with partial pivoting
+		for (int col = 0; col < NUM_TERMS; col++) {
+			int pivot = col;
+			for (int row = col + 1; row < NUM_TERMS; row++) if (std::abs(a[row][col]) > std::abs(a[pivot][col])) pivot = row;
+			if (std::abs(a[pivot][col]) < 1e-30) return;
+			for (int k = 0; k <= NUM_TERMS; k++) std::swap(a[col][k], a[pivot][k]);
+			for (int row = 0; row < NUM_TERMS; row++) {
+				if (row == col) continue;
+				const double factor = a[row][col] / a[col][col];
+				for (int k = col; k <= NUM_TERMS; k++) a[row][k] -= factor * a[col][k];
+			}
+		}
+
+		bool bNegative = false;
+		for (int i = 0; i < NUM_TERMS; i++) {
+			costs[i] = bUsed[i] ? a[i][NUM_TERMS] / a[i][i] : 0.0;
+			if (costs[i] < 0.0) {
+				bUsed[i] = false;
+				bNegative = true;
+			}
+		}
+		if (!bNegative) break;
+	}
+
+	sphereCost = float(std::max(0.0, costs[0]));
+	threadCost = float(std::max(0.0, costs[1]));
+	serialCost = float(std::max(0.0, costs[2]));
+	bFitted = true;
+}
+
+void CFrameScheduler::Report(std::ostream& out)
+{
+	if (reportFrames == 0) return;
+
+	out << "Scheduler over " << reportFrames << " frames, " << lastSpheres << " spheres, budget " << frameBudget * 1000.0f << "ms\n";
+	out << "  mean phase " << totalPhaseTime / reportFrames * 1000.0 << "ms, over budget " << overBudgetFrames << " frames, mean imbalance " << totalImbalance / reportFrames << "\n";
+	out << "  model " << sphereCost * 1e9f << "ns per sphere parallel, " << serialCost * 1e9f << "ns per sphere serial, " << threadCost * 1e6f << "us per thread\n";
+	out << "  active workers:";
+	for (int i = 0; i < int(workerCounts.size()); i++) if (workerCounts.at(i)) out << " " << i << "x" << workerCounts.at(i);
+	out << "\n  chunks per thread:";
+	for (int i = 0; i < int(chunkCounts.size()); i++) if (chunkCounts.at(i)) out << " " << i << "x" << chunkCounts.at(i);
+	out << "\n";
+
+	std::fill(workerCounts.begin(), workerCounts.end(), 0);
+	std::fill(chunkCounts.begin(), chunkCounts.end(), 0);
+	totalPhaseTime = 0.0;
+	totalImbalance = 0.0;
+	reportFrames = 0;
+	overBudgetFrames = 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <ostream>
+
+struct ScheduleDecision {
+	int activeWorkers = 0;		//Workers woken this frame, the main thread always takes part as well
+	int chunksPerThread = 1;	//Chunks each participant owns, idle participants steal the rest
+	float predictedTime = 0.0f;
+};
+
+//Picks how many workers to wake and how finely to split the collision phase each frame.
+//Phase time is modelled as spheres * sphereCost / threads + threads * threadCost + spheres * serialCost, with all three
+//fitted online from measured frames. The serial term soaks up whatever doesn't speed up with more threads, such as
+//memory bandwidth or too few cores. The fewest threads predicted to fit the frame budget are used and the rest stay parked.
+class CFrameScheduler
+{
+public:
+	void Reset(int maxWorkers, float frameBudget);
+
+	ScheduleDecision Plan(int numSpheres);
+	//phaseTime is the wall time of the collision phase, busyTimes how long each participant spent working.
+	void Record(const ScheduleDecision& decision, int numSpheres, float phaseTime, const std::vector<float>& busyTimes);
+
+	//Writes what the scheduler has picked since the last report and the current cost model, then clears the counts.
+	void Report(std::ostream& out);
+
+private:
+	float Predict(int numThreads, int numSpheres) const;
+	void Solve();
+
+	int maxWorkers = 0;
+	float frameBudget = 0.0f;
+	int frame = 0;
+	int chunksPerThread = 1;
+
+	//Exponentially weighted least squares sums for time = a * (spheres / threads) + b * threads + c * spheres
+	static const int NUM_TERMS = 3;
+	double sumXX[NUM_TERMS][NUM_TERMS] = {};
+	double sumXY[NUM_TERMS] = {};
+	float sphereCost = 0.0f;
+	float threadCost = 0.0f;
+	float serialCost = 0.0f;
+	bool bFitted = false;
+
+	//Report counters
+	std::vector<int> workerCounts;
+	std::vector<int> chunkCounts;
+	double totalPhaseTime = 0.0;
+	double totalImbalance = 0.0;
+	int reportFrames = 0;
+	int overBudgetFrames = 0;
+	int lastSpheres = 0;
+};
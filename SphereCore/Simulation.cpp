@@ -0,0 +1,849 @@
+#pragma once
+#include "Simulation.h"
+#include "Affinity.h"
+#include "AllocationCounter.h"
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+
+CSimulation::CSimulation(const SimulationConfig& Config) : config(Config) {
+	adaptiveDispatch = config.adaptiveScheduling && config.spinParkBarrier;
+	stripMargin = config.StripMargin();
+	slabMin = config.xMinCoord;
+	slabMax = config.xMaxCoord;
+
+	//LOD batches are picked out fresh every frame so a strip would be rebuilt for nearly every chunk
+	if (config.lodScheduling) config.stripPartitioning = false;
+	//Graph chunks go to whichever thread is free, which would rebuild strips just as often
+	graphDispatch = config.taskGraph && config.spinParkBarrier && !config.lodScheduling;
+	if (graphDispatch) {
+		adaptiveDispatch = false;
+		config.stripPartitioning = false;
+	}
+	const vector2 worldCentre = { (config.xMinCoord + config.xMaxCoord) * 0.5f, (config.yMinCoord + config.yMaxCoord) * 0.5f };
+	lodFocusMin = worldCentre;
+	lodFocusMax = worldCentre;
+	const float maxXVelocity = std::max(std::abs(config.xVelocityPosLimit), std::abs(config.xVelocityNegLimit));
+	const float maxYVelocity = std::max(std::abs(config.yVelocityPosLimit), std::abs(config.yVelocityNegLimit));
+	maxSpeed = std::sqrt(maxXVelocity * maxXVelocity + maxYVelocity * maxYVelocity);
+}
+
+CSimulation::~CSimulation() {
+	//Workers are woken one last time and leave instead of working
+	bStopping = true;
+	if (numWorkers > 0) {
+		if (config.spinParkBarrier) frameBarrier.Release();
+		else for (int i = 0; i < numWorkers; i++) {
+			auto& workThread = collisionWorkers[i].first;
+			{
+				std::unique_lock<std::mutex> lock(workThread.lock);
+				collisionWorkers[i].second.bComplete = false;
+			}
+			workThread.bAvaliableWork.notify_one();
+		}
+	}
+	for (int i = 0; i < numWorkers; i++) collisionWorkers[i].first.thread.join();
+
+	for (auto sphere : staticSpheresUpdateData) delete sphere;
+	for (auto sphere : dynamicSpheresUpdateData) delete sphere;
+	for (auto sphere : spareSpheres) delete sphere;
+	delete transport;
+	delete stream;
+	delete recorder;
+	delete compact;
+	delete chunked;
+	delete volume;
+	delete grid;
+}
+
+void CSimulation::Start() {
+	//Processes are forked before any threads are created
+	if (config.numSlabs > 1) {
+		transport = SocketTransport::LaunchLocal(config.numSlabs);
+		if (transport == nullptr) std::cout << "Multi-process slabs not supported on this platform, running in one process\n";
+	}
+
+	//Finds out avaliable cores for current machine and dispatches appropiate amount of threads.
+	numWorkers = config.numWorkers;
+	if (numWorkers < 0) numWorkers = NumCores() / NumRanks() - 1;
+	if (numWorkers < 0) numWorkers = 0;
+	if (numWorkers > MAX_WORKERS) numWorkers = MAX_WORKERS;
+	if (!PinCurrentThread(config.workerAffinity, 0, numWorkers + 1)) std::cout << "Thread affinity not supported on this platform\n";
+	if (config.perfCounters && !counters.Open()) std::cout << "Performance counters not available, check perf_event_paranoid\n";
+	frameBarrier.Reset(numWorkers);
+	scheduler.Reset(numWorkers, config.frameBudget);
+	for (int i = 0; i < numWorkers; i++) {
+		collisionWorkers[i].first.thread = std::thread(&CSimulation::CollisionThread, this, i);
+	}
+
+	Setup();
+	if (transport) PartitionSlab();
+	threadUpdateKernel = SelectKernel(config, staticSpheresUpdateData, dynamicSpheresUpdateData);
+	if (config.dimensions == 3) {
+		if (transport || graphDispatch || config.lodScheduling) {
+			std::cout << "3-D worlds don't run with slabs, the task graph or LOD scheduling, simulating in 2-D\n";
+			config.dimensions = 2;
+		}
+		else {
+			//The volume keeps its own statics and storage
+			config.stripPartitioning = false;
+			config.positionStorage = EPositionStorage::Float;
+			config.chunkSize = 0.0f;
+			config.broadphase = EBroadphase::Sweep;
+			volume = CVolumeWorld::Create(config, staticSpheresUpdateData, dynamicSpheresUpdateData);
+		}
+	}
+	if (config.positionStorage != EPositionStorage::Float) {
+		if (transport || graphDispatch || config.lodScheduling || config.bounds == EBounds::Open || config.chunkSize > 0.0f) std::cout << "Fixed point storage doesn't run with slabs, the task graph, LOD scheduling, open bounds or chunks, storing floats\n";
+		else {
+			compact = ICompactWorld::Create(config, staticSpheresUpdateData, dynamicSpheresUpdateData);
+			if (compact == nullptr) std::cout << "16 bit positions are too coarse for spheres this small in a world this big, storing floats\n";
+			//The compact statics are already packed
+			else config.stripPartitioning = false;
+		}
+	}
+	if (config.chunkSize > 0.0f) {
+		if (transport || graphDispatch || config.lodScheduling) std::cout << "Chunked storage doesn't run with slabs, the task graph or LOD scheduling, storing flat arrays\n";
+		else {
+			//Chunks already hold packed statics around their dynamics
+			config.stripPartitioning = false;
+			chunked = CChunkedWorld::Create(config, threadUpdateKernel, staticSpheresUpdateData, dynamicSpheresUpdateData);
+		}
+	}
+
+	if (config.broadphase == EBroadphase::HierarchicalGrid) {
+		if (compact || chunked) std::cout << "The hierarchical grid doesn't run with fixed point or chunked storage, sweeping\n";
+		else BuildGrid();
+	}
+
+	if (!config.streamName.empty()) {
+		std::string name = config.streamName;
+		if (NumRanks() > 1) name += "." + std::to_string(Rank());
+		const uint32_t fields = (config.bStreamVelocity ? uint32_t(StreamVelocity) : 0u) | (config.bStreamHp ? uint32_t(StreamHp) : 0u);
+		//Room for every sphere in the world so a slab never overflows it however many spheres migrate in
+		stream = CFrameStreamWriter::Create(name.c_str(), config.circleAmount, config.streamSlots, fields);
+		if (stream == nullptr) std::cout << "Couldn't create the shared memory frame stream " << name << "\n";
+	}
+	if (!config.replayPath.empty()) {
+		if (transport) std::cout << "Replays only record single process runs, not recording\n";
+		else {
+			ReplaySettings settings;
+			settings.keyframeInterval = config.replayKeyframeInterval;
+			settings.positionStep = config.replayPositionStep;
+			settings.velocityStep = config.replayVelocityStep;
+			recorder = CReplayRecorder::Create(config.replayPath.c_str(), settings, staticSpheresUpdateData, dynamicSpheresUpdateData);
+			if (recorder == nullptr) std::cout << "Couldn't open replay file " << config.replayPath << "\n";
+		}
+	}
+
+	if (config.lodScheduling) {
+		lodTilesX = std::max(1, int(std::ceil((config.xMaxCoord - config.xMinCoord) / config.lodTileSize)));
+		lodTilesY = std::max(1, int(std::ceil((config.yMaxCoord - config.yMinCoord) / config.lodTileSize)));
+		lodTilePeriods.resize(lodTilesX * lodTilesY, 1);
+		//Sized for every dynamic in one batch so a moving focus never regrows them
+		for (auto& batch : lodBatches) batch.reserve(config.circleAmount);
+	}
+	frameStartAllocations = HeapAllocationCount();
+}
+
+void CSimulation::Step(float frameTime) {
+	std::fill(std::begin(phaseTimes), std::end(phaseTimes), 0.0f);
+	phaseStart = std::chrono::steady_clock::now();
+	if (counters.IsOpen()) {
+		counters.Read(countersLast);
+		counterFrames++;
+	}
+	if (config.checkAllocations) {
+		const size_t allocations = HeapAllocationCount();
+		if (frame > config.allocationWarmupFrames && allocations != frameStartAllocations) std::cout << "Frame " << frame << " made " << allocations - frameStartAllocations << " heap allocations\n";
+		frameStartAllocations = allocations;
+	}
+	mainWork.arena.Reset();
+
+	//Per frame velocities move spheres by exactly one velocity each frame
+	const float step = config.bScaleByFrameTime ? std::min(frameTime, config.maxFrameTime) : 1.0f;
+
+	//Sorts dynamic spheres for no current benefit but will benefit moving collision when implemented.
+	if (compact) compact->Sort();
+	else if (chunked) chunked->BeginFrame();
+	else if (volume) volume->Sort();
+	else if (!bDynamicsSorted) std::sort(dynamicSpheresUpdateData.begin(), dynamicSpheresUpdateData.end(), SortCondition);
+	bDynamicsSorted = false;
+	EndPhase(SortPhase);
+
+	//Published before workers start so the snapshot is a consistent end of last frame, the task graph publishes as it ends the frame instead
+	if (config.publishQueries && !graphDispatch) {
+		//Brings the spheres up to date from fixed point, chunked or 3-D storage if any is on
+		Dynamics();
+		spatialQuery.Publish(staticSpheresUpdateData, dynamicSpheresUpdateData, frame);
+		EndPhase(PublishPhase);
+	}
+	frame++;
+
+	//Each steps its own storage, the dynamics array only sets how much work there is
+	if (compact || chunked || volume) {
+		if (compact) compact->BeginFrame(step);
+		Dispatch(dynamicSpheresUpdateData, step);
+		bDynamicsStale = true;
+	}
+	else if (config.lodScheduling) StepLod(step);
+	else if (graphDispatch) DispatchGraph(step);
+	else Dispatch(dynamicSpheresUpdateData, step);
+	EndPhase(CollidePhase);
+
+	if (transport) {
+		MigrateSpheres();
+		EndPhase(MigratePhase);
+	}
+	else if (chunked) {
+		chunked->Migrate();
+		EndPhase(MigratePhase);
+	}
+	if (stream || recorder) {
+		//Brings the spheres up to date from fixed point, chunked or 3-D storage if any is on
+		Dynamics();
+		if (stream) stream->Write(frame, staticSpheresUpdateData, dynamicSpheresUpdateData);
+		if (recorder) recorder->Record(frame, step, dynamicSpheresUpdateData);
+		EndPhase(OutputPhase);
+	}
+}
+
+const std::vector<CircleUpdateData*>& CSimulation::Dynamics() const {
+	if (bDynamicsStale) {
+		if (compact) compact->Decode(dynamicSpheresUpdateData);
+		else if (chunked) chunked->Gather(dynamicSpheresUpdateData);
+		else volume->Gather(dynamicSpheresUpdateData);
+		bDynamicsStale = false;
+	}
+	return dynamicSpheresUpdateData;
+}
+
+void CSimulation::Report(std::ostream& out) {
+	if (adaptiveDispatch) scheduler.Report(out);
+	if (grid) out << "Hierarchical grid: " << grid->NumLevels() << " levels, " << grid->NumCells() << " cells\n";
+	if (volume) out << "3-D grid: " << volume->NumCells() << " cells of " << volume->CellSize() << "\n";
+	if (chunked) out << "Chunks of " << chunked->ChunkSize() << ": " << chunked->NumChunks() << " allocated, " << chunked->NumActiveChunks() << " with dynamics, " << chunked->NumPooledChunks() << " pooled\n";
+
+	if (counters.IsOpen() && counterFrames > 0) {
+		out << "Performance counters per frame over " << counterFrames << " frames";
+		if ((counters.Available() & (1u << PerfCycles)) == 0) out << ", no hardware counters on this machine";
+		out << "\n";
+		auto counted = [](const PerfTotals& totals) {
+			for (double count : totals.counts) if (count != 0.0) return true;
+			return false;
+		};
+		const char* phaseNames[NUM_FRAME_PHASES] = { "sort", "publish", graphDispatch ? "frame graph" : "collide", "migrate", "output" };
+		for (int phase = 0; phase < NUM_FRAME_PHASES; phase++) {
+			if (counted(phaseCounters[phase])) WritePerfLine(out, phaseNames[phase], phaseCounters[phase], counterFrames, counters.Available());
+			phaseCounters[phase] = PerfTotals();
+		}
+		for (int i = 0; i < numWorkers; i++) {
+			auto& work = collisionWorkers[i].second;
+			const std::string name = "worker " + std::to_string(i + 1);
+			if (counted(work.counterTotals)) WritePerfLine(out, name.c_str(), work.counterTotals, counterFrames, work.counters.Available());
+			work.counterTotals = PerfTotals();
+		}
+		counterFrames = 0;
+	}
+}
+
+void CSimulation::SetLodFocus(vector2 min, vector2 max) {
+	lodFocusMin = min;
+	lodFocusMax = max;
+}
+
+void CSimulation::Setup() {
+	int halfAmount = config.circleAmount / 2;
+	int remainingAmount = config.circleAmount - halfAmount;
+
+	std::default_random_engine gen;
+	gen.seed(config.seed);
+	std::uniform_real_distribution<> radiusDistribution(config.sphereRadius - config.sphereRadiusVariation, config.sphereRadius + config.sphereRadiusVariation);
+	std::uniform_real_distribution<> logRadiusDistribution(std::log(std::max(config.sphereRadius - config.sphereRadiusVariation, 1e-3f)), std::log(config.sphereRadius + config.sphereRadiusVariation));
+	auto randomRadius = [&]() {
+		if (config.bLogUniformRadius) return float(std::exp(logRadiusDistribution(gen)));
+		return float(radiusDistribution(gen));
+	};
+	std::uniform_real_distribution<> xPosDistribution(config.xMinCoord, config.xMaxCoord);
+	std::uniform_real_distribution<> yPosDistribution(config.yMinCoord, config.yMaxCoord);
+
+	//Clustered spheres are spread evenly over a disc around a random centre, drawn again if they land outside the world rather
+	//than being stacked on its edge
+	std::vector<vector2> clusterCentres;
+	for (int i = 0; i < config.numClusters; i++) clusterCentres.emplace_back(vector2{ float(xPosDistribution(gen)), float(yPosDistribution(gen)) });
+	std::uniform_int_distribution<> clusterDistribution(0, std::max(config.numClusters - 1, 0));
+	std::uniform_real_distribution<> unitDistribution(0.0, 1.0);
+	auto randomPosition = [&]() {
+		if (clusterCentres.empty()) return vector2{ float(xPosDistribution(gen)), float(yPosDistribution(gen)) };
+		const vector2 centre = clusterCentres.at(clusterDistribution(gen));
+		while (true) {
+			const float distance = config.clusterRadius * float(std::sqrt(unitDistribution(gen)));
+			const float angle = 6.28318531f * float(unitDistribution(gen));
+			const vector2 pos = { centre.x + distance * std::cos(angle), centre.y + distance * std::sin(angle) };
+			if (pos.x >= config.xMinCoord && pos.x <= config.xMaxCoord && pos.y >= config.yMinCoord && pos.y <= config.yMaxCoord) return pos;
+		}
+	};
+
+	for (int i = 0; i < halfAmount; i++) {
+		CircleUpdateData* tempUpdate = new CircleUpdateData();
+
+		tempUpdate->pos = randomPosition();
+		tempUpdate->velocity = { 0.0f, 0.0f };
+		tempUpdate->radius = config.sphereRadius;
+		if (config.sphereRadiusVariation > 0.0f) tempUpdate->radius = randomRadius();
+		tempUpdate->id = i;
+		staticSpheresUpdateData.emplace_back(tempUpdate);
+	}
+	for (int i = 0; i < remainingAmount; i++) {
+
+		CircleUpdateData* tempUpdate = new CircleUpdateData();
+		std::uniform_real_distribution<> xVelocDistribution(config.xVelocityNegLimit, config.xVelocityPosLimit);
+		std::uniform_real_distribution<> yVelocDistribution(config.yVelocityNegLimit, config.yVelocityPosLimit);
+
+		tempUpdate->pos = randomPosition();
+		tempUpdate->velocity = { float(xVelocDistribution(gen)), float(yVelocDistribution(gen)) };
+		tempUpdate->radius = config.sphereRadius;
+		if (config.sphereRadiusVariation > 0.0f) tempUpdate->radius = randomRadius();
+		tempUpdate->id = i;
+		dynamicSpheresUpdateData.emplace_back(tempUpdate);
+	}
+
+	std::sort(staticSpheresUpdateData.begin(), staticSpheresUpdateData.end(), SortCondition);
+}
+
+//Builds the hierarchical grid over the statics on the worker pool, borrowing the frame's task graph before any frame runs.
+//Without the spin park barrier to release the workers with, the main thread builds it alone.
+void CSimulation::BuildGrid() {
+	grid = new CHierarchicalGrid();
+	gridUpdateKernel = SelectGridKernel(config);
+	config.stripPartitioning = false;
+
+	const bool bPool = config.spinParkBarrier && numWorkers > 0;
+	grid->PlanBuild(staticSpheresUpdateData, bPool ? (numWorkers + 1) * GRAPH_CHUNKS_PER_THREAD : 1, taskGraph);
+	taskGraph.Reset();
+	if (bPool) {
+		bBuildingGrid = true;
+		frameBarrier.Release();
+	}
+	taskGraph.Run([&](int stage, int index) { grid->RunBuildTask(stage, index); });
+	if (bPool) {
+		frameBarrier.WaitForWorkers();
+		bBuildingGrid = false;
+	}
+	//The frame's own graph is built from scratch the first time it's needed
+	taskGraph.Clear();
+	graphChunks = 0;
+}
+
+void CSimulation::CollisionThread(int thread) {
+	auto& worker = collisionWorkers[thread].first;
+	auto& work = collisionWorkers[thread].second;
+
+	//Pinned before any work so the strip cache is first touched on this worker's node
+	if (!PinCurrentThread(config.workerAffinity, thread + 1, numWorkers + 1)) std::cout << "Couldn't pin collision worker " << thread + 1 << "\n";
+	if (config.perfCounters) work.counters.Open();
+	unsigned int generation = 0;
+	while (true) {
+		if (config.spinParkBarrier) generation = frameBarrier.WaitForRelease(thread, generation);
+		else {
+			std::unique_lock<std::mutex> lock(worker.lock);
+			worker.bAvaliableWork.wait(lock, [&]() {return !work.bComplete; });
+		}
+		if (bStopping) return;
+		if (work.counters.IsOpen()) work.counters.Read(work.countersLast);
+
+		work.arena.Reset();
+		if (bBuildingGrid) taskGraph.Run([&](int stage, int index) { grid->RunBuildTask(stage, index); });
+		else if (graphDispatch) taskGraph.Run([&](int stage, int chunk) { RunGraphTask(thread + 1, stage, chunk); });
+		else if (adaptiveDispatch) RunFrameTasks(thread + 1);
+		//collision work
+		else if (config.stripPartitioning) {
+			//Nothing else touches a fixed share's spheres, so its ends can be read here
+			const auto& spheres = *work.dynamicSpheresUpdateData;
+			if (work.numDynamicSpheres > 0) UpdateStaticStrip(work, spheres[work.dynamicSphereStart]->pos.x, spheres[work.dynamicSphereStart + work.numDynamicSpheres - 1]->pos.x);
+			ThreadUpdate(work.staticStripView, work.dynamicSphereStart, work.numDynamicSpheres, work.frameTime, work.arena);
+		}
+		else ThreadUpdate(*work.staticSpheresUpdateData, work.dynamicSphereStart, work.numDynamicSpheres, work.frameTime, work.arena);
+		if (work.counters.IsOpen()) work.counters.Lap(work.countersLast, work.counterTotals);
+
+		//The task graph and adaptive dispatch always run with the barrier
+		if (config.spinParkBarrier) {
+			frameBarrier.Arrive();
+			continue;
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(worker.lock);
+			work.bComplete = true;
+		}
+
+		worker.bAvaliableWork.notify_one();
+	}
+}
+
+//Rebuilds the worker's packed copy of statics when its dynamic chunk, from firstX to lastX, has drifted outside the cached
+//strip. Statics never move so the copy stays valid until the strip bounds change.
+void CSimulation::UpdateStaticStrip(CollisionWork& work, float firstX, float lastX) {
+	//Chunk is sorted by x so its bounds are its first and last sphere
+	const float minX = firstX - stripMargin;
+	const float maxX = lastX + stripMargin;
+	if (minX >= work.stripMin && maxX <= work.stripMax) return;
+
+	work.stripMin = minX - config.stripSlack;
+	work.stripMax = maxX + config.stripSlack;
+
+	auto& allStatics = staticSpheresUpdateData;
+	const float stripMin = work.stripMin;
+	const float stripMax = work.stripMax;
+	auto first = std::lower_bound(allStatics.begin(), allStatics.end(), stripMin, [](CircleUpdateData* a, float x)
+		{
+			return a->pos.x < x;
+		});
+	auto last = std::upper_bound(first, allStatics.end(), stripMax, [](float x, CircleUpdateData* a)
+		{
+			return x < a->pos.x;
+		});
+
+	//Reserved once for the whole static array so a strip never reallocates as the split changes.
+	//Only the pages a strip actually fills are ever touched, so the reserve costs address space rather than memory.
+	if (work.staticStrip.capacity() < allStatics.size()) {
+		work.staticStrip.reserve(allStatics.size());
+		work.staticStripView.reserve(allStatics.size());
+	}
+	work.staticStrip.clear();
+	for (auto it = first; it != last; it++) work.staticStrip.emplace_back(**it);
+
+	//View is rebuilt after the copy as the strip may have reallocated
+	work.staticStripView.clear();
+	for (auto& sphere : work.staticStrip) work.staticStripView.emplace_back(&sphere);
+}
+
+//Runs one collision phase over spheres, which must be sorted by x.
+void CSimulation::Dispatch(std::vector<CircleUpdateData*>& spheres, float frameTime) {
+	//Workers only read this once released, which orders it before them
+	dispatchSpheres = &spheres;
+	if (adaptiveDispatch) DispatchAdaptive(frameTime);
+	else DispatchFixed(frameTime);
+	dispatchSpheres = &dynamicSpheresUpdateData;
+}
+
+//Even split between the main thread and every worker.
+void CSimulation::DispatchFixed(float frameTime) {
+	//Sets up each threads work for the frame and sets them off.
+	int chunkAmount = dispatchSpheres->size() / (numWorkers + 1);
+	for (int i = 0; i < numWorkers; i++) {
+		auto& work = collisionWorkers[i].second;
+		work.dynamicSpheresUpdateData = dispatchSpheres;
+		work.dynamicSphereStart = i * chunkAmount;
+		work.numDynamicSpheres = chunkAmount;
+		work.staticSpheresUpdateData = &staticSpheresUpdateData;
+		work.frameTime = frameTime;
+		if (config.spinParkBarrier) continue;
+
+		auto& workThread = collisionWorkers[i].first;
+		{
+			std::unique_lock<std::mutex> lock(workThread.lock);
+			work.bComplete = false;
+		}
+
+		workThread.bAvaliableWork.notify_one();
+	}
+
+	if (config.spinParkBarrier) frameBarrier.Release();
+
+	//Runs remaining spheres collision on main thread
+	int remainingSpheres = dispatchSpheres->size() - chunkAmount * numWorkers;
+	ThreadUpdate(staticSpheresUpdateData, chunkAmount * numWorkers, remainingSpheres, frameTime, mainWork.arena);
+
+	//Waits for all threads to sync back up
+	if (config.spinParkBarrier) frameBarrier.WaitForWorkers();
+	else for (int i = 0; i < numWorkers; i++) {
+		auto& workThread = collisionWorkers[i].first;
+		auto& work = collisionWorkers[i].second;
+
+		std::unique_lock<std::mutex> lock(workThread.lock);
+		workThread.bAvaliableWork.wait(lock, [&]() {return work.bComplete; });
+	}
+}
+
+//Splits the frame as the scheduler decides, wakes only the workers it asked for and feeds the timings back.
+void CSimulation::DispatchAdaptive(float frameTime) {
+	const int numSpheres = int(dispatchSpheres->size());
+	const ScheduleDecision decision = scheduler.Plan(numSpheres);
+
+	frameTasks.frameTime = frameTime;
+	frameTasks.numParticipants = decision.activeWorkers + 1;
+	frameTasks.chunksPerThread = decision.chunksPerThread;
+	frameTasks.numChunks = frameTasks.numParticipants * frameTasks.chunksPerThread;
+	frameTasks.chunkSize = (numSpheres + frameTasks.numChunks - 1) / frameTasks.numChunks;
+	for (int i = 0; i < frameTasks.numParticipants; i++) {
+		frameTasks.cursors[i].next.store(0);
+		if (!config.stripPartitioning) continue;
+		const int shareStart = std::min(i * frameTasks.chunksPerThread * frameTasks.chunkSize, numSpheres);
+		const int shareEnd = std::min((i + 1) * frameTasks.chunksPerThread * frameTasks.chunkSize, numSpheres);
+		frameTasks.shareFirstX[i] = shareStart < shareEnd ? (*dispatchSpheres)[shareStart]->pos.x : 0.0f;
+		frameTasks.shareLastX[i] = shareStart < shareEnd ? (*dispatchSpheres)[shareEnd - 1]->pos.x : -1.0f;
+	}
+
+	auto phaseStart = std::chrono::steady_clock::now();
+	frameBarrier.Release(decision.activeWorkers);
+	RunFrameTasks(0);
+	frameBarrier.WaitForWorkers();
+	const float phaseTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - phaseStart).count();
+
+	scheduler.Record(decision, numSpheres, phaseTime, frameTasks.busyTimes);
+}
+
+void CSimulation::RunFrameTasks(int participant) {
+	auto start = std::chrono::steady_clock::now();
+	auto& work = participant == 0 ? mainWork : collisionWorkers[participant - 1].second;
+	const int numSpheres = int(dispatchSpheres->size());
+
+	//Starts with its own share then moves on to steal from the participants after it
+	for (int offset = 0; offset < frameTasks.numParticipants; offset++) {
+		const int owner = (participant + offset) % frameTasks.numParticipants;
+		const int firstChunk = owner * frameTasks.chunksPerThread;
+		const int endChunk = std::min(firstChunk + frameTasks.chunksPerThread, frameTasks.numChunks);
+
+		//Only its own share is worth caching in the strip, stolen chunks search the full static array
+		const bool bStrip = config.stripPartitioning && owner == participant;
+		if (bStrip && frameTasks.shareFirstX[owner] <= frameTasks.shareLastX[owner]) UpdateStaticStrip(work, frameTasks.shareFirstX[owner], frameTasks.shareLastX[owner]);
+		auto& staticSpheres = bStrip ? work.staticStripView : staticSpheresUpdateData;
+
+		auto& cursor = frameTasks.cursors[owner].next;
+		while (true) {
+			const int chunk = firstChunk + cursor.fetch_add(1);
+			if (chunk >= endChunk) break;
+			const int sphereStart = chunk * frameTasks.chunkSize;
+			const int amount = std::min(frameTasks.chunkSize, numSpheres - sphereStart);
+			if (amount > 0) ThreadUpdate(staticSpheres, sphereStart, amount, frameTasks.frameTime, work.arena);
+		}
+	}
+
+	frameTasks.busyTimes.at(participant) = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+}
+
+//Builds the frame's task graph over numChunks even chunks of the dynamics.
+void CSimulation::BuildGraph(int numChunks) {
+	taskGraph.Clear();
+	graphChunks = numChunks;
+	graphMaxRadii.assign(numChunks, 0.0f);
+
+	std::vector<int> collide(numChunks);
+	std::vector<int> reorder(numChunks);
+	std::vector<int> seam(std::max(numChunks - 1, 0));
+	for (int chunk = 0; chunk < numChunks; chunk++) collide.at(chunk) = taskGraph.Add(Collide, chunk);
+	for (int chunk = 0; chunk < numChunks; chunk++) {
+		reorder.at(chunk) = taskGraph.Add(Reorder, chunk);
+		taskGraph.Depend(reorder.at(chunk), collide.at(chunk));
+	}
+
+	//Seam i sorts across the edge between chunks i and i + 1 and can move spheres anywhere in either, so neighbouring seams
+	//mustn't overlap. Even seams go first and each odd seam waits for the even seams either side of it.
+	for (int parity = 0; parity < 2; parity++) {
+		for (int edge = parity; edge < numChunks - 1; edge += 2) {
+			seam.at(edge) = taskGraph.Add(Seam, edge);
+			taskGraph.Depend(seam.at(edge), reorder.at(edge));
+			taskGraph.Depend(seam.at(edge), reorder.at(edge + 1));
+			if (parity == 0) continue;
+			taskGraph.Depend(seam.at(edge), seam.at(edge - 1));
+			if (edge + 1 < numChunks - 1) taskGraph.Depend(seam.at(edge), seam.at(edge + 1));
+		}
+	}
+
+	//Publishing a chunk reads the last sphere before it and the first after it, so it waits on every seam that can move those
+	for (int chunk = 0; chunk < numChunks; chunk++) {
+		const int publish = taskGraph.Add(Publish, chunk);
+		if (numChunks == 1) taskGraph.Depend(publish, reorder.at(chunk));
+		for (int edge = std::max(chunk - 2, 0); edge <= std::min(chunk + 1, numChunks - 2); edge++) taskGraph.Depend(publish, seam.at(edge));
+	}
+}
+
+//Runs the frame as a task graph over chunks of the sorted dynamics. Each chunk collides, sorts itself and then trades
+//spheres across its edges with its neighbours so the whole array is sorted again, then merges its stretch of the snapshot.
+//Stages only wait on their own chunk and its neighbours, so no thread sits idle between stages while others catch up.
+void CSimulation::DispatchGraph(float frameTime) {
+	const int numSpheres = int(dynamicSpheresUpdateData.size());
+	const int numChunks = std::max(1, std::min((numWorkers + 1) * GRAPH_CHUNKS_PER_THREAD, numSpheres / MIN_GRAPH_CHUNK));
+	if (numChunks != graphChunks) BuildGraph(numChunks);
+
+	graphFrameTime = frameTime;
+	bOutOfOrder = false;
+	if (config.publishQueries) spatialQuery.BeginPublish(staticSpheresUpdateData.size() + numSpheres);
+	taskGraph.Reset();
+	frameBarrier.Release();
+	taskGraph.Run([&](int stage, int chunk) { RunGraphTask(0, stage, chunk); });
+	frameBarrier.WaitForWorkers();
+
+	//Only a sphere crossing more than a whole chunk in one frame is left out of place by the seams
+	if (bOutOfOrder) {
+		std::sort(dynamicSpheresUpdateData.begin(), dynamicSpheresUpdateData.end(), SortCondition);
+		if (config.publishQueries) {
+			const float maxRadius = spatialQuery.PublishRange(0, staticSpheresUpdateData.begin(), staticSpheresUpdateData.end(), dynamicSpheresUpdateData.begin(), dynamicSpheresUpdateData.end());
+			spatialQuery.EndPublish(maxRadius, frame);
+		}
+	}
+	else if (config.publishQueries) spatialQuery.EndPublish(*std::max_element(graphMaxRadii.begin(), graphMaxRadii.end()), frame);
+	bDynamicsSorted = true;
+}
+
+void CSimulation::RunGraphTask(int participant, int stage, int chunk) {
+	auto& spheres = dynamicSpheresUpdateData;
+	const int numSpheres = int(spheres.size());
+	const int start = GraphChunkStart(chunk);
+	const int end = GraphChunkStart(chunk + 1);
+
+	auto& work = participant == 0 ? mainWork : collisionWorkers[participant - 1].second;
+	switch (stage) {
+	case Collide:
+		if (end > start) ThreadUpdate(staticSpheresUpdateData, start, end - start, graphFrameTime, work.arena);
+		break;
+	case Reorder: {
+		//Spheres only move a little each frame so the chunk is nearly in order already, where insertion sort is close to
+		//linear. Keys are copied out first so the shifting runs over one packed array instead of reaching into every sphere.
+		struct SortKey {
+			float x;
+			CircleUpdateData* sphere;
+		};
+		const int count = end - start;
+		SortKey* keys = work.arena.Allocate<SortKey>(count);
+		for (int i = 0; i < count; i++) keys[i] = { spheres[start + i]->pos.x, spheres[start + i] };
+		for (int i = 1; i < count; i++) {
+			const SortKey key = keys[i];
+			int j = i;
+			for (; j > 0 && key.x < keys[j - 1].x; j--) keys[j] = keys[j - 1];
+			keys[j] = key;
+		}
+		for (int i = 0; i < count; i++) spheres[start + i] = keys[i].sphere;
+		break;
+	}
+	case Seam: {
+		//Swaps the largest sphere left of the edge with the smallest right of it and sorts each back into its chunk
+		//until the two sides are in order
+		const int rightEnd = GraphChunkStart(chunk + 2);
+		while (end > start && end < rightEnd && SortCondition(spheres[end], spheres[end - 1])) {
+			std::swap(spheres[end - 1], spheres[end]);
+			for (int i = end - 1; i > start && SortCondition(spheres[i], spheres[i - 1]); i--) std::swap(spheres[i], spheres[i - 1]);
+			for (int i = end; i + 1 < rightEnd && SortCondition(spheres[i + 1], spheres[i]); i++) std::swap(spheres[i], spheres[i + 1]);
+		}
+		break;
+	}
+	case Publish: {
+		//Chunks' stretches only tile the snapshot when every chunk is in order with its neighbours
+		if ((start > 0 && start < end && SortCondition(spheres[start], spheres[start - 1])) || (end > start && end < numSpheres && SortCondition(spheres[end], spheres[end - 1]))) {
+			bOutOfOrder = true;
+			break;
+		}
+		if (!config.publishQueries) break;
+
+		//Takes the statics from this chunk's first sphere up to the next chunk's, the outer chunks take the rest
+		auto& statics = staticSpheresUpdateData;
+		auto firstRightOf = [&](float x) {
+			return std::lower_bound(statics.begin(), statics.end(), x, [](CircleUpdateData* a, float x)
+				{
+					return a->pos.x < x;
+				});
+		};
+		auto staticFirst = chunk == 0 ? statics.begin() : firstRightOf(spheres[start]->pos.x);
+		auto staticLast = chunk == graphChunks - 1 ? statics.end() : firstRightOf(spheres[end]->pos.x);
+		graphMaxRadii.at(chunk) = spatialQuery.PublishRange(start + (staticFirst - statics.begin()), staticFirst, staticLast, spheres.begin() + start, spheres.begin() + end);
+		break;
+	}
+	}
+}
+
+int CSimulation::GraphChunkStart(int chunk) const {
+	return int((long long)(std::min(chunk, graphChunks)) * dynamicSpheresUpdateData.size() / graphChunks);
+}
+
+void CSimulation::ThreadUpdate(std::vector<CircleUpdateData*>& staticSpheres, int dynamicSphereStart, int dynamicSpheresAmount, float frameTime, CFrameArena& arena) {
+	if (compact) compact->Update(dynamicSphereStart, dynamicSpheresAmount);
+	else if (chunked) chunked->Update(dynamicSphereStart, dynamicSpheresAmount, frameTime, arena);
+	else if (volume) volume->Update(dynamicSphereStart, dynamicSpheresAmount, frameTime, arena);
+	//The grid refers to statics by their place in the full array, strips are off when it's on
+	else if (grid) gridUpdateKernel(config, *grid, staticSpheresUpdateData, *dispatchSpheres, dynamicSphereStart, dynamicSpheresAmount, frameTime, arena);
+	else threadUpdateKernel(config, staticSpheres, *dispatchSpheres, dynamicSphereStart, dynamicSpheresAmount, frameTime, arena);
+}
+
+//Steps only the dynamics whose tile is due this frame, each by every frame since it was last stepped.
+//Spheres owed the same number of frames were last stepped together, so each count shares one step and goes through the
+//workers as one batch. Batches owed more than a frame are split into substeps so none moves further than a full rate frame,
+//or a sphere's radius if that's further, keeping the sweep from stepping over statics.
+void CSimulation::StepLod(float step) {
+	lodStepHistory[frame % LOD_HISTORY] = step;
+	UpdateTilePeriods();
+
+	for (auto& batch : lodBatches) batch.clear();
+	for (auto sphere : dynamicSpheresUpdateData) {
+		const int owed = frame - sphere->lodFrame;
+		//Staggered by id so each rate's spheres are spread evenly over its frames.
+		//Spheres changing rate can be owed more than a period, never more than the history covers.
+		if ((frame + sphere->id) % TilePeriod(sphere->pos) != 0 && owed < LOD_HISTORY) continue;
+		lodBatches[std::min(owed, LOD_HISTORY) - 1].emplace_back(sphere);
+		sphere->lodFrame = frame;
+	}
+
+	const float maxStepDistance = std::max(maxSpeed * step, config.sphereRadius - config.sphereRadiusVariation);
+	for (int owed = 1; owed <= LOD_HISTORY; owed++) {
+		auto& batch = lodBatches[owed - 1];
+		if (batch.empty()) continue;
+
+		float owedTime = 0.0f;
+		for (int i = 0; i < owed; i++) owedTime += lodStepHistory[(frame - i) % LOD_HISTORY];
+		int substeps = 1;
+		if (maxStepDistance > 0.0f) substeps = std::max(1, int(std::ceil(maxSpeed * owedTime / maxStepDistance)));
+		for (int substep = 0; substep < substeps; substep++) Dispatch(batch, owedTime / substeps);
+	}
+}
+
+//Rate of each tile from its distance to the focus, tiles touching the focus run every frame.
+void CSimulation::UpdateTilePeriods() {
+	for (int tileY = 0; tileY < lodTilesY; tileY++) {
+		for (int tileX = 0; tileX < lodTilesX; tileX++) {
+			const vector2 tileMin = { config.xMinCoord + tileX * config.lodTileSize, config.yMinCoord + tileY * config.lodTileSize };
+			const vector2 tileMax = tileMin + vector2{ config.lodTileSize, config.lodTileSize };
+			const float xGap = std::max(0.0f, std::max(lodFocusMin.x - tileMax.x, tileMin.x - lodFocusMax.x));
+			const float yGap = std::max(0.0f, std::max(lodFocusMin.y - tileMax.y, tileMin.y - lodFocusMax.y));
+			const float distance = std::sqrt(xGap * xGap + yGap * yGap);
+
+			int period = 1;
+			float reach = config.lodFullRateDistance;
+			while (distance >= reach && period < MAX_LOD_PERIOD) {
+				period *= 2;
+				reach *= 2.0f;
+			}
+			lodTilePeriods.at(tileY * lodTilesX + tileX) = period;
+		}
+	}
+}
+
+int CSimulation::TilePeriod(vector2 pos) const {
+	//Spheres past the world edges belong to the edge tiles
+	const int tileX = std::min(std::max(int((pos.x - config.xMinCoord) / config.lodTileSize), 0), lodTilesX - 1);
+	const int tileY = std::min(std::max(int((pos.y - config.yMinCoord) / config.lodTileSize), 0), lodTilesY - 1);
+	return lodTilePeriods.at(tileY * lodTilesX + tileX);
+}
+
+//Slab that owns a given x position, spheres past the world edges belong to the outermost slabs.
+int CSimulation::SlabOwner(float x) const {
+	const int numRanks = transport->NumRanks();
+	const float slabWidth = (config.xMaxCoord - config.xMinCoord) / numRanks;
+	int owner = int((x - config.xMinCoord) / slabWidth);
+	if (owner < 0) owner = 0;
+	if (owner >= numRanks) owner = numRanks - 1;
+	return owner;
+}
+
+//Drops every sphere outside this process's slab and swaps halo statics with the neighbouring slabs.
+//Statics never move so the halo only needs exchanging once, after that only dynamics cross slab edges.
+void CSimulation::PartitionSlab() {
+	const int rank = transport->Rank();
+	const int numRanks = transport->NumRanks();
+	const float slabWidth = (config.xMaxCoord - config.xMinCoord) / numRanks;
+	slabMin = config.xMinCoord + slabWidth * rank;
+	slabMax = config.xMinCoord + slabWidth * (rank + 1);
+	//Statics this close to a slab edge are copied to the neighbouring slab so its dynamics can collide with them.
+	const float haloWidth = stripMargin;
+
+	std::vector<CircleUpdateData> leftHalo;
+	std::vector<CircleUpdateData> rightHalo;
+	std::vector<CircleUpdateData*> ownedStatics;
+	for (auto sphere : staticSpheresUpdateData) {
+		if (SlabOwner(sphere->pos.x) != rank) {
+			delete sphere;
+			continue;
+		}
+		if (rank > 0 && sphere->pos.x < slabMin + haloWidth) leftHalo.emplace_back(*sphere);
+		if (rank < numRanks - 1 && sphere->pos.x >= slabMax - haloWidth) rightHalo.emplace_back(*sphere);
+		ownedStatics.emplace_back(sphere);
+	}
+	staticSpheresUpdateData = ownedStatics;
+
+	if (rank > 0) {
+		ExchangeWith(rank - 1, leftHalo);
+		for (auto& sphere : incoming) staticSpheresUpdateData.emplace_back(new CircleUpdateData(sphere));
+	}
+	if (rank < numRanks - 1) {
+		ExchangeWith(rank + 1, rightHalo);
+		for (auto& sphere : incoming) staticSpheresUpdateData.emplace_back(new CircleUpdateData(sphere));
+	}
+	std::sort(staticSpheresUpdateData.begin(), staticSpheresUpdateData.end(), SortCondition);
+
+	std::vector<CircleUpdateData*> ownedDynamics;
+	for (auto sphere : dynamicSpheresUpdateData) {
+		if (SlabOwner(sphere->pos.x) == rank) ownedDynamics.emplace_back(sphere);
+		else delete sphere;
+	}
+	dynamicSpheresUpdateData = ownedDynamics;
+}
+
+//Hands dynamics that left this slab during the frame to the neighbouring slab and takes in any crossing the other way.
+//Only a neighbour is reached in a round, so with wrap bounds, where a sphere crossing the seam lands in the slab at the far
+//end, arrivals that are only passing through are handed on in further rounds until every sphere is with its owner.
+void CSimulation::MigrateSpheres() {
+	const int rank = transport->Rank();
+	const int numRanks = transport->NumRanks();
+	const int numRounds = config.bounds == EBounds::Wrap ? numRanks - 1 : 1;
+
+	auto adopt = [&](const CircleUpdateData& sphere) {
+		if (spareSpheres.empty()) dynamicSpheresUpdateData.emplace_back(new CircleUpdateData(sphere));
+		else {
+			*spareSpheres.back() = sphere;
+			dynamicSpheresUpdateData.emplace_back(spareSpheres.back());
+			spareSpheres.pop_back();
+		}
+	};
+	//Only the last round's arrivals can be in the wrong slab
+	size_t checkFrom = 0;
+	for (int round = 0; round < numRounds; round++) {
+		leftOutgoing.clear();
+		rightOutgoing.clear();
+		for (size_t i = checkFrom; i < dynamicSpheresUpdateData.size();) {
+			auto sphere = dynamicSpheresUpdateData.at(i);
+			const int owner = SlabOwner(sphere->pos.x);
+			if (owner == rank) {
+				i++;
+				continue;
+			}
+
+			//Without wrapping a sphere can't cross more than one slab a frame, anything further is forwarded again next frame
+			if (owner < rank) leftOutgoing.emplace_back(*sphere);
+			else rightOutgoing.emplace_back(*sphere);
+			spareSpheres.emplace_back(sphere);
+			dynamicSpheresUpdateData.at(i) = dynamicSpheresUpdateData.back();
+			dynamicSpheresUpdateData.pop_back();
+		}
+
+		checkFrom = dynamicSpheresUpdateData.size();
+		if (rank > 0) {
+			ExchangeWith(rank - 1, leftOutgoing);
+			for (auto& sphere : incoming) adopt(sphere);
+		}
+		if (rank < numRanks - 1) {
+			ExchangeWith(rank + 1, rightOutgoing);
+			for (auto& sphere : incoming) adopt(sphere);
+		}
+	}
+	//Leavers are swapped out from the back and arrivals added there
+	bDynamicsSorted = false;
+}
+
+//Swaps spheres with a neighbouring slab into incoming. A slab that can't be reached has lost or will lose spheres, so rather
+//than carry on with a partial world the process stops, and its neighbours stop in turn as their next exchange with it fails.
+void CSimulation::ExchangeWith(int otherRank, const std::vector<CircleUpdateData>& outgoing) {
+	incoming.clear();
+	if (transport->Exchange(otherRank, outgoing, incoming)) return;
+	std::cout << "Slab " << transport->Rank() << " lost its connection to slab " << otherRank << ", stopping" << std::endl;
+	std::_Exit(EXIT_FAILURE);
+}
+
+//Everything since the last phase ended is put down to this one
+void CSimulation::EndPhase(EFramePhase phase) {
+	const auto now = std::chrono::steady_clock::now();
+	phaseTimes[phase] = std::chrono::duration<float>(now - phaseStart).count();
+	phaseStart = now;
+	if (counters.IsOpen()) counters.Lap(countersLast, phaseCounters[phase]);
+}
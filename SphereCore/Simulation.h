@@ -0,0 +1,227 @@
+#pragma once
+#include "SphereData.h"
+#include "SimulationConfig.h"
+#include "Collision.h"
+#include "Transport.h"
+#include "SpatialQuery.h"
+#include "FrameBarrier.h"
+#include "Scheduler.h"
+#include "FrameArena.h"
+#include "TaskGraph.h"
+#include "FrameStream.h"
+#include "Replay.h"
+#include "PerfCounters.h"
+#include "CompactWorld.h"
+#include "ChunkedWorld.h"
+#include "VolumeWorld.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <ostream>
+#include <chrono>
+
+//Enough for every hardware thread of a two socket, 64 core per socket server with SMT, less the main thread
+const int MAX_WORKERS = 255;
+//Slowest rate the LOD scheduler steps a tile at, one frame in this many
+const int MAX_LOD_PERIOD = 8;
+//Frames of step history kept, enough for a sphere moving from the slowest rate to any other
+const int LOD_HISTORY = MAX_LOD_PERIOD * 2;
+//Task graph chunks, enough per thread for a thread done early to have others to take, but never tiny
+const int GRAPH_CHUNKS_PER_THREAD = 4;
+const int MIN_GRAPH_CHUNK = 256;
+
+//One world of static and dynamic spheres plus the worker pool that steps it.
+//Front ends fill in a SimulationConfig, call Start once and then Step every frame, reading sphere state in between.
+class CSimulation
+{
+public:
+	//Parts of Step timed separately. The task graph sorts and publishes inside its collision phase.
+	enum EFramePhase { SortPhase, PublishPhase, CollidePhase, MigratePhase, OutputPhase, NUM_FRAME_PHASES };
+
+	CSimulation(const SimulationConfig& config);
+	~CSimulation();
+	CSimulation(const CSimulation&) = delete;
+	CSimulation& operator=(const CSimulation&) = delete;
+
+	//Forks any slab processes, starts the workers and generates the world.
+	//With more than one slab this must be called before the front end creates any threads of its own.
+	void Start();
+	//Advances the world one frame. frameTime only moves spheres when the config scales by frame time.
+	void Step(float frameTime);
+	//Writes the scheduler's report when adaptive scheduling is on and the performance counters when they're on,
+	//covering the frames since the last report.
+	void Report(std::ostream& out);
+	//Area the LOD scheduler keeps at full rate, usually what the camera sees. Starts as the centre of the world.
+	void SetLodFocus(vector2 min, vector2 max);
+
+	//Both sorted by x between frames, pointers stay valid for the life of the simulation unless spheres migrate between slabs.
+	//With fixed point, chunked or 3-D storage the dynamics are brought up to date from it the first time they're asked for after a step.
+	const std::vector<CircleUpdateData*>& Statics() const { return staticSpheresUpdateData; }
+	const std::vector<CircleUpdateData*>& Dynamics() const;
+	const CSpatialQuery& Queries() const { return spatialQuery; }
+	//The hierarchical grid if it's the broadphase, nullptr otherwise
+	const CHierarchicalGrid* Grid() const { return grid; }
+	//The 3-D world if the config has 3 dimensions, nullptr otherwise
+	const CVolumeWorld* Volume() const { return volume; }
+	const SimulationConfig& Config() const { return config; }
+	int Frame() const { return frame; }
+	int NumWorkers() const { return numWorkers; }
+	//Seconds the phase took in the last frame, 0 if it was skipped
+	float PhaseTime(EFramePhase phase) const { return phaseTimes[phase]; }
+	int Rank() const { return transport ? transport->Rank() : 0; }
+	int NumRanks() const { return transport ? transport->NumRanks() : 1; }
+
+private:
+	struct Thread {
+		std::thread thread;
+		std::condition_variable bAvaliableWork;
+		std::mutex lock;
+	};
+
+	struct CollisionWork {
+		bool bComplete = true;
+		//Point at the main thread's arrays, which aren't touched while workers are running
+		std::vector<CircleUpdateData*>* dynamicSpheresUpdateData = nullptr;
+		int dynamicSphereStart;
+		int numDynamicSpheres;
+		std::vector<CircleUpdateData*>* staticSpheresUpdateData = nullptr;
+		float frameTime;
+
+		//Scratch memory for the frame, reset when the thread starts each frame
+		CFrameArena arena;
+
+		//Strip partitioning, the strip is built by the worker itself so its memory is first touched on that worker's node.
+		std::vector<CircleUpdateData> staticStrip;
+		std::vector<CircleUpdateData*> staticStripView;
+		float stripMin = 0.0f;
+		float stripMax = -1.0f;
+
+		//Opened by the worker itself, counts from when it's woken to when it finishes each frame
+		CPerfCounters counters;
+		PerfReading countersLast;
+		PerfTotals counterTotals;
+	};
+
+	//Chunks of the sorted dynamics for the adaptive dispatch. Participant 0 is the main thread, participant i is worker i - 1.
+	//Each participant owns chunksPerThread neighbouring chunks and steals from the others once its own are done.
+	struct FrameTasks {
+		float frameTime = 0.0f;
+		int numParticipants = 1;
+		int chunksPerThread = 1;
+		int chunkSize = 0;
+		int numChunks = 0;
+
+		//Next unclaimed chunk in each participant's share, kept on separate cache lines as they're hammered by different threads
+		struct alignas(64) Cursor {
+			std::atomic<int> next{ 0 };
+		};
+		Cursor cursors[MAX_WORKERS + 1];
+		std::vector<float> busyTimes = std::vector<float>(MAX_WORKERS + 1, 0.0f);
+		//x of the first and last sphere of each participant's share for its strip, read before release as a thief may be
+		//moving them by the time their owner builds its strip. An empty share has first above last.
+		float shareFirstX[MAX_WORKERS + 1] = {};
+		float shareLastX[MAX_WORKERS + 1] = {};
+	};
+
+	void Setup();
+	void CollisionThread(int thread);
+	void UpdateStaticStrip(CollisionWork& work, float firstX, float lastX);
+	void Dispatch(std::vector<CircleUpdateData*>& spheres, float frameTime);
+	void DispatchFixed(float frameTime);
+	void DispatchAdaptive(float frameTime);
+	void RunFrameTasks(int participant);
+	void BuildGraph(int numChunks);
+	void DispatchGraph(float frameTime);
+	void RunGraphTask(int participant, int stage, int chunk);
+	int GraphChunkStart(int chunk) const;
+	void ThreadUpdate(std::vector<CircleUpdateData*>& staticSpheres, int dynamicSphereStart, int dynamicSpheresAmount, float frameTime, CFrameArena& arena);
+	void StepLod(float step);
+	void UpdateTilePeriods();
+	int TilePeriod(vector2 pos) const;
+	int SlabOwner(float x) const;
+	void PartitionSlab();
+	void MigrateSpheres();
+	void ExchangeWith(int otherRank, const std::vector<CircleUpdateData>& outgoing);
+	void EndPhase(EFramePhase phase);
+	void BuildGrid();
+
+	SimulationConfig config;
+	bool adaptiveDispatch = false;
+	bool graphDispatch = false;
+	float stripMargin = 0.0f;
+	ThreadUpdateFunction threadUpdateKernel = nullptr;
+
+	std::vector<CircleUpdateData*> staticSpheresUpdateData;
+	//Mutable so Dynamics() can bring it up to date from compact, chunked or 3-D storage
+	mutable std::vector<CircleUpdateData*> dynamicSpheresUpdateData;
+	//Dynamics the current dispatch steps, all of them unless the LOD scheduler picked out a batch
+	std::vector<CircleUpdateData*>* dispatchSpheres = &dynamicSpheresUpdateData;
+	//Still sorted from the end of the last task graph frame, so the next frame can skip its sort
+	bool bDynamicsSorted = false;
+	int frame = 0;
+	size_t frameStartAllocations = 0;
+
+	std::pair<Thread, CollisionWork> collisionWorkers[MAX_WORKERS];
+	CollisionWork mainWork;
+	FrameTasks frameTasks;
+	int numWorkers = 0;
+	std::atomic<bool> bStopping{ false };
+
+	ITransport* transport = nullptr;
+	float slabMin = 0.0f;
+	float slabMax = 0.0f;
+	//Kept between frames so migration reuses its buffers and the storage of spheres that left
+	std::vector<CircleUpdateData> leftOutgoing;
+	std::vector<CircleUpdateData> rightOutgoing;
+	std::vector<CircleUpdateData> incoming;
+	std::vector<CircleUpdateData*> spareSpheres;
+
+	//LOD scheduling
+	vector2 lodFocusMin = { 0.0f, 0.0f };
+	vector2 lodFocusMax = { 0.0f, 0.0f };
+	int lodTilesX = 0;
+	int lodTilesY = 0;
+	std::vector<int> lodTilePeriods;
+	//Step taken each frame, indexed by frame number
+	float lodStepHistory[LOD_HISTORY] = {};
+	//Spheres due this frame grouped by how many frames they're owed, batch i is owed i + 1
+	std::vector<CircleUpdateData*> lodBatches[LOD_HISTORY];
+	float maxSpeed = 0.0f;
+
+	//Task graph frame, also used to build the hierarchical grid
+	enum EGraphStage { Collide, Reorder, Seam, Publish };
+	CTaskGraph taskGraph;
+	int graphChunks = 0;
+	float graphFrameTime = 0.0f;
+	//Largest radius in each chunk's stretch of the snapshot
+	std::vector<float> graphMaxRadii;
+	std::atomic<bool> bOutOfOrder{ false };
+
+	//Wall time of each phase of the last frame and the main thread's performance counters, both lapped as each phase ends
+	std::chrono::steady_clock::time_point phaseStart;
+	float phaseTimes[NUM_FRAME_PHASES] = {};
+	CPerfCounters counters;
+	PerfReading countersLast;
+	PerfTotals phaseCounters[NUM_FRAME_PHASES];
+	int counterFrames = 0;
+
+	//Fixed point, chunked and 3-D storage, at most one is used. Whenever bDynamicsStale is set the spheres' state is behind fixed
+	//point or 3-D storage, or the dynamics array's order is behind the chunks.
+	ICompactWorld* compact = nullptr;
+	CChunkedWorld* chunked = nullptr;
+	CVolumeWorld* volume = nullptr;
+	mutable bool bDynamicsStale = false;
+
+	//Hierarchical grid broadphase, built on the pool while bBuildingGrid is set
+	CHierarchicalGrid* grid = nullptr;
+	GridUpdateFunction gridUpdateKernel = nullptr;
+	bool bBuildingGrid = false;
+
+	CSpatialQuery spatialQuery;
+	CFrameStreamWriter* stream = nullptr;
+	CReplayRecorder* recorder = nullptr;
+	CFrameBarrier frameBarrier;
+	CFrameScheduler scheduler;
+};
@@ -0,0 +1,143 @@
+#pragma once
+#include "Affinity.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+//What happens at the world edges. Wrap moves spheres to the opposite edge but doesn't detect collisions across the seam.
+enum class EBounds { Reflective, Wrap, Open };
+//How each dynamic finds the statics it may touch. The sweep walks the x-sorted statics as far as the largest radius could
+//reach, the hierarchical grid bins statics by size so worlds mixing tiny and huge spheres only search what can reach them.
+enum class EBroadphase { Sweep, HierarchicalGrid };
+//How the simulation holds sphere state while stepping, see CompactWorld.h. Fixed16 needs a world small enough next to its
+//spheres for a position quantum to be under a sixteenth of the smallest radius.
+enum class EPositionStorage { Float, Fixed32, Fixed16 };
+
+//Everything a front end picks about the world and how it's simulated. Defaults are the headless 100k sphere setup.
+struct SimulationConfig {
+	int circleAmount = 100000;
+	float xMinCoord = -5000.0f;
+	float xMaxCoord = 5000.0f;
+	float yMinCoord = -5000.0f;
+	float yMaxCoord = 5000.0f;
+	//Only used by 3-D worlds
+	float zMinCoord = -5000.0f;
+	float zMaxCoord = 5000.0f;
+
+	float xVelocityPosLimit = 5.0f;
+	float xVelocityNegLimit = -5.0f;
+	float yVelocityPosLimit = 5.0f;
+	float yVelocityNegLimit = -5.0f;
+	float zVelocityPosLimit = 5.0f;
+	float zVelocityNegLimit = -5.0f;
+	//Velocities are per second and scaled by the frame time, otherwise they're per frame
+	bool bScaleByFrameTime = false;
+	//Longest step a scaled frame may take, stops a stalled frame throwing spheres through each other
+	float maxFrameTime = 0.1f;
+
+	float sphereRadius = 10.0f;
+	//Radii are drawn up to this far either side of sphereRadius, 0 gives every sphere the same radius
+	float sphereRadiusVariation = 0.0f;
+	//Draws radii with log spread over the same range instead, as many between 1 and 10 as between 10 and 100
+	bool bLogUniformRadius = false;
+	EBounds bounds = EBounds::Reflective;
+
+	//Seeds the world, processes of a slab run must share it
+	unsigned int seed = 0;
+	//Spawns spheres in this many clusters of clusterRadius around points spread over the world, 0 spreads them evenly
+	int numClusters = 0;
+	float clusterRadius = 500.0f;
+
+	//Workers alongside the main thread, -1 uses every core left after the slab processes
+	int numWorkers = -1;
+	//Pins the main thread and collision workers, None leaves scheduling to the OS.
+	EAffinity workerAffinity = EAffinity::None;
+	//Starts and ends frames with a spin then park barrier instead of a condition variable per worker.
+	bool spinParkBarrier = true;
+	//Lets the scheduler pick how many workers to wake and how finely to split the frame, needs spinParkBarrier.
+	bool adaptiveScheduling = true;
+	//Time the collision phase is allowed each frame
+	float frameBudget = 1.0f / 60.0f;
+
+	//Runs each frame as a graph of chunked stages instead of one collision phase between serial sorting and publishing.
+	//A chunk can be sorting or publishing while others are still colliding, so threads don't wait between stages.
+	//Needs spinParkBarrier, takes the place of adaptive scheduling and strips, and isn't used with LOD scheduling.
+	bool taskGraph = false;
+
+	//Gathers every contact for a dynamic sphere before applying one averaged correction, so results don't depend on
+	//sweep order or how the frame was split between threads.
+	bool jacobiResolution = false;
+
+	//Finds where each dynamic's sweep starts by walking on from the previous dynamic's start rather than binary searching
+	//the statics, prefetching ahead as it goes. Dynamics are sorted by x so the walk is short.
+	bool coherentSweep = true;
+
+	//Gives each worker a packed copy of only the static spheres around its x-strip so lookups stay in its own cache.
+	bool stripPartitioning = true;
+	//Extra distance added when a strip is rebuilt so small drift between frames doesn't force a rebuild.
+	float stripSlack = 200.0f;
+
+	//See HierarchicalGrid.h. The grid takes the place of strips and isn't used with fixed point or chunked
+	//storage, which keep their own statics.
+	EBroadphase broadphase = EBroadphase::Sweep;
+
+	//Fixed point positions and 16 bit velocities, halving what's streamed each frame and making every thread count step the
+	//world identically. Takes the place of strips and isn't used with the task graph, LOD scheduling, slabs or open bounds.
+	//The spheres' floats are only brought up to date when something reads them.
+	EPositionStorage positionStorage = EPositionStorage::Float;
+
+	//Holds the world in square chunks of this size that only exist where there are spheres, see ChunkedWorld.h, for worlds
+	//mostly made of empty space. 0 keeps flat arrays. Grown to the halo if smaller, takes the place of strips and isn't used
+	//with fixed point storage, the task graph, LOD scheduling or slabs. Best with open bounds, which leave the world unbounded.
+	float chunkSize = 0.0f;
+
+	//3 simulates spheres in a box rather than circles on a plane, see VolumeWorld.h. Takes the place of strips, fixed point
+	//and chunked storage and the hierarchical grid, and isn't used with the task graph, LOD scheduling or slabs. Front ends
+	//drawing the world flat show it from above.
+	int dimensions = 2;
+
+	//Splits the world into this many x slabs each simulated by its own process, 1 keeps everything in this process.
+	int numSlabs = 1;
+
+	//Steps dynamics far from the focus given to SetLodFocus less often, decided per square tile of lodTileSize.
+	//Tiles within lodFullRateDistance of the focus step every frame, each doubling of distance past it halves the rate down
+	//to one frame in eight. Slower tiles take the frames they missed in one go, split so no step moves a sphere further
+	//than a full rate frame or its radius would. Turns strip partitioning off as the batches stepped change every frame.
+	bool lodScheduling = false;
+	float lodTileSize = 500.0f;
+	float lodFullRateDistance = 1000.0f;
+
+	//Publishes a snapshot of every sphere each frame for spatial queries to be served from.
+	bool publishQueries = true;
+
+	//Writes every frame's spheres to a ring of streamSlots frames in shared memory under this name for other processes to
+	//read, see FrameStream.h. Empty leaves streaming off, slab processes each add their rank to the name.
+	std::string streamName;
+	int streamSlots = 4;
+	bool bStreamVelocity = false;
+	bool bStreamHp = false;
+
+	//Records every frame's dynamics to this file for CReplayPlayer to read back, see Replay.h. Empty leaves recording off,
+	//slab runs don't record. Quantized to the given steps with a keyframe every replayKeyframeInterval frames.
+	std::string replayPath;
+	int replayKeyframeInterval = 60;
+	float replayPositionStep = 1.0f / 64.0f;
+	float replayVelocityStep = 1.0f / 1024.0f;
+
+	//Counts cycles, instructions and cache, branch and TLB misses through each phase of a frame and each worker's share of
+	//the collision phase, written out by Report, see PerfCounters.h. Start and Step must be called from the same thread.
+	bool perfCounters = false;
+
+	//Reports any frame after warm up that touches the heap, the steady state loop should make no allocations.
+	bool checkAllocations = true;
+	int allocationWarmupFrames = 100;
+
+	float MaxRadius() const { return sphereRadius + sphereRadiusVariation; }
+
+	//Distance a strip or slab halo reaches past its spheres, covers both radii plus a frame of movement and collision push out.
+	float StripMargin() const {
+		const float maxStep = bScaleByFrameTime ? maxFrameTime : 1.0f;
+		const float maxXVelocity = std::max(std::abs(xVelocityPosLimit), std::abs(xVelocityNegLimit));
+		return 4.0f * MaxRadius() + 2.0f * maxXVelocity * maxStep;
+	}
+};
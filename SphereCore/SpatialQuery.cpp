@@ -0,0 +1,217 @@
+#pragma once
+#include "SpatialQuery.h"
+#include <algorithm>
+#include "Affinity.h"
+#include <thread>
+#include <atomic>
+
+//Queries a pool thread takes at once, enough that threads rarely contend on the counter but few enough to even out
+//batches of very different queries
+const int QUERIES_PER_TAKE = 16;
+
+std::vector<SphereHit>::const_iterator CWorldSnapshot::FirstReaching(float x) const
+{
+	return std::lower_bound(spheres.begin(), spheres.end(), x - maxRadius, [](const SphereHit& a, float x)
+		{
+			return a.pos.x < x;
+		});
+}
+
+void CWorldSnapshot::QueryRect(vector2 min, vector2 max, std::vector<SphereHit>& hits) const
+{
+	for (auto it = FirstReaching(min.x); it != spheres.end() && it->pos.x <= max.x + maxRadius; it++) {
+		//Closest point on the rectangle to the sphere centre
+		const float closestX = std::max(min.x, std::min(it->pos.x, max.x));
+		const float closestY = std::max(min.y, std::min(it->pos.y, max.y));
+		const float xDiff = it->pos.x - closestX;
+		const float yDiff = it->pos.y - closestY;
+		if (xDiff * xDiff + yDiff * yDiff <= it->radius * it->radius) hits.emplace_back(*it);
+	}
+}
+
+void CWorldSnapshot::QueryRadius(vector2 centre, float radius, std::vector<SphereHit>& hits) const
+{
+	for (auto it = FirstReaching(centre.x - radius); it != spheres.end() && it->pos.x <= centre.x + radius + maxRadius; it++) {
+		const float xDiff = it->pos.x - centre.x;
+		const float yDiff = it->pos.y - centre.y;
+		const float reach = radius + it->radius;
+		if (xDiff * xDiff + yDiff * yDiff <= reach * reach) hits.emplace_back(*it);
+	}
+}
+
+void CWorldSnapshot::QueryNearest(vector2 point, int count, std::vector<SphereHit>& hits) const
+{
+	if (count <= 0 || spheres.empty()) return;
+
+	//Max heap of the best candidates so far, worst on top
+	std::vector<std::pair<float, const SphereHit*>> best;
+	auto consider = [&](const SphereHit& sphere) {
+		const float xDiff = sphere.pos.x - point.x;
+		const float yDiff = sphere.pos.y - point.y;
+		const float distSq = xDiff * xDiff + yDiff * yDiff;
+		if (best.size() < size_t(count)) {
+			best.emplace_back(distSq, &sphere);
+			std::push_heap(best.begin(), best.end());
+		}
+		else if (distSq < best.front().first) {
+			std::pop_heap(best.begin(), best.end());
+			best.back() = { distSq, &sphere };
+			std::push_heap(best.begin(), best.end());
+		}
+	};
+
+	//Sweeps outwards in x from the point, stopping each side once the x distance alone beats the worst candidate
+	auto start = std::lower_bound(spheres.begin(), spheres.end(), point.x, [](const SphereHit& a, float x)
+		{
+			return a.pos.x < x;
+		});
+	auto sweepRight = start;
+	auto sweepLeft = start;
+	bool bRight = true;
+	bool bLeft = sweepLeft != spheres.begin();
+	while (bRight || bLeft) {
+		if (bRight) {
+			if (sweepRight == spheres.end()) bRight = false;
+			else {
+				const float xDiff = sweepRight->pos.x - point.x;
+				if (best.size() == size_t(count) && xDiff * xDiff > best.front().first) bRight = false;
+				else consider(*sweepRight++);
+			}
+		}
+		if (bLeft) {
+			const float xDiff = point.x - (sweepLeft - 1)->pos.x;
+			if (best.size() == size_t(count) && xDiff * xDiff > best.front().first) bLeft = false;
+			else {
+				sweepLeft--;
+				consider(*sweepLeft);
+				if (sweepLeft == spheres.begin()) bLeft = false;
+			}
+		}
+	}
+
+	std::sort_heap(best.begin(), best.end());
+	for (auto& candidate : best) hits.emplace_back(*candidate.second);
+}
+
+void CWorldSnapshot::Query(const SphereQuery& query, std::vector<SphereHit>& hits) const
+{
+	switch (query.type) {
+	case SphereQuery::Rect: QueryRect(query.min, query.max, hits); break;
+	case SphereQuery::Radius: QueryRadius(query.min, query.radius, hits); break;
+	case SphereQuery::Nearest: QueryNearest(query.min, query.count, hits); break;
+	}
+}
+
+void CSpatialQuery::Publish(const std::vector<CircleUpdateData*>& staticSpheres, const std::vector<CircleUpdateData*>& dynamicSpheres, int frame)
+{
+	BeginPublish(staticSpheres.size() + dynamicSpheres.size());
+	const float maxRadius = PublishRange(0, staticSpheres.begin(), staticSpheres.end(), dynamicSpheres.begin(), dynamicSpheres.end());
+	EndPublish(maxRadius, frame);
+}
+
+void CSpatialQuery::BeginPublish(size_t numSpheres)
+{
+	publishing.reset();
+	for (auto& spare : pool) {
+		if (spare.use_count() == 1) {
+			//Pairs with the last reader dropping its reference before we write over the snapshot
+			std::atomic_thread_fence(std::memory_order_acquire);
+			publishing = spare;
+			break;
+		}
+	}
+	if (!publishing) {
+		publishing = std::make_shared<CWorldSnapshot>();
+		pool.emplace_back(publishing);
+	}
+	publishing->spheres.resize(numSpheres);
+}
+
+float CSpatialQuery::PublishRange(size_t offset, SphereIterator staticFirst, SphereIterator staticLast, SphereIterator dynamicFirst, SphereIterator dynamicLast)
+{
+	//Both inputs are already sorted by x so a merge keeps the snapshot sorted without a full sort
+	auto out = publishing->spheres.begin() + offset;
+	float maxRadius = 0.0f;
+	auto staticIt = staticFirst;
+	auto dynamicIt = dynamicFirst;
+	while (staticIt != staticLast || dynamicIt != dynamicLast) {
+		bool bTakeDynamic = staticIt == staticLast || (dynamicIt != dynamicLast && (*dynamicIt)->pos.x < (*staticIt)->pos.x);
+		CircleUpdateData* sphere = bTakeDynamic ? *dynamicIt++ : *staticIt++;
+		*out++ = { sphere->pos, sphere->radius, sphere->id, bTakeDynamic };
+		if (sphere->radius > maxRadius) maxRadius = sphere->radius;
+	}
+	return maxRadius;
+}
+
+void CSpatialQuery::EndPublish(float maxRadius, int frame)
+{
+	publishing->maxRadius = maxRadius;
+	publishing->frame = frame;
+	std::atomic_store(&current, std::shared_ptr<const CWorldSnapshot>(publishing));
+	publishing.reset();
+}
+
+std::shared_ptr<const CWorldSnapshot> CSpatialQuery::Snapshot() const
+{
+	return std::atomic_load(&current);
+}
+
+void CSpatialQuery::QueryBatch(const std::vector<SphereQuery>& queries, std::vector<std::vector<SphereHit>>& results, CQueryPool& pool) const
+{
+	results.resize(queries.size());
+	for (auto& hits : results) hits.clear();
+	auto snapshot = Snapshot();
+	if (!snapshot) return;
+	pool.Run(*snapshot, queries, results);
+}
+
+CQueryPool::CQueryPool(int NumThreads)
+{
+	numThreads = NumThreads;
+	if (numThreads < 0) numThreads = NumCores();
+	if (numThreads <= 0) numThreads = 1;
+	barrier.Reset(numThreads - 1);
+	for (int i = 0; i < numThreads - 1; i++) threads.emplace_back(&CQueryPool::WorkerLoop, this, i);
+}
+
+CQueryPool::~CQueryPool()
+{
+	bStopping = true;
+	barrier.Release();
+	for (auto& thread : threads) thread.join();
+}
+
+void CQueryPool::Run(const CWorldSnapshot& Snapshot, const std::vector<SphereQuery>& Queries, std::vector<std::vector<SphereHit>>& Results)
+{
+	snapshot = &Snapshot;
+	queries = &Queries;
+	results = &Results;
+	nextQuery = 0;
+	//Not worth waking anyone for a batch the calling thread gets through in a few takes
+	const bool bWake = int(Queries.size()) > QUERIES_PER_TAKE;
+	if (bWake) barrier.Release();
+	RunQueries();
+	if (bWake) barrier.WaitForWorkers();
+}
+
+void CQueryPool::WorkerLoop(int worker)
+{
+	unsigned int generation = 0;
+	while (true) {
+		generation = barrier.WaitForRelease(worker, generation);
+		if (bStopping) return;
+		RunQueries();
+		barrier.Arrive();
+	}
+}
+
+void CQueryPool::RunQueries()
+{
+	const int numQueries = int(queries->size());
+	while (true) {
+		const int start = nextQuery.fetch_add(QUERIES_PER_TAKE);
+		if (start >= numQueries) return;
+		const int end = std::min(numQueries, start + QUERIES_PER_TAKE);
+		for (int i = start; i < end; i++) snapshot->Query((*queries)[i], (*results)[i]);
+	}
+}
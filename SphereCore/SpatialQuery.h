@@ -0,0 +1,112 @@
+#pragma once
+#include "SphereData.h"
+#include "FrameBarrier.h"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+struct SphereHit {
+	vector2 pos;
+	float radius;
+	int id;
+	bool bDynamic;
+};
+
+struct SphereQuery {
+	enum EType { Rect, Radius, Nearest };
+	EType type = Radius;
+	vector2 min = { 0.0f, 0.0f };		//Rect corner, or centre for Radius and Nearest
+	vector2 max = { 0.0f, 0.0f };		//Rect corner
+	float radius = 0.0f;				//Radius queries
+	int count = 1;						//Nearest queries
+};
+
+//Immutable copy of one frame's spheres, sorted by x the same way the broadphase is.
+//Any number of threads can query a snapshot at once.
+class CWorldSnapshot
+{
+public:
+	void QueryRect(vector2 min, vector2 max, std::vector<SphereHit>& hits) const;
+	void QueryRadius(vector2 centre, float radius, std::vector<SphereHit>& hits) const;
+	//Nearest count spheres to point by centre distance, closest first.
+	void QueryNearest(vector2 point, int count, std::vector<SphereHit>& hits) const;
+	void Query(const SphereQuery& query, std::vector<SphereHit>& hits) const;
+
+	int Frame() const { return frame; }
+	size_t Size() const { return spheres.size(); }
+
+private:
+	friend class CSpatialQuery;
+
+	//First sphere that could reach x, every sphere before it is too far left
+	std::vector<SphereHit>::const_iterator FirstReaching(float x) const;
+
+	std::vector<SphereHit> spheres;
+	float maxRadius = 0.0f;
+	int frame = -1;
+};
+
+//Threads kept for running query batches, so a batch costs waking them rather than creating them. The calling thread is one
+//of the pool and idle threads park on a frame barrier. A pool runs one batch at a time, callers batching at the same time
+//each keep their own.
+class CQueryPool
+{
+public:
+	//numThreads of -1 uses every core
+	CQueryPool(int numThreads = -1);
+	~CQueryPool();
+	CQueryPool(const CQueryPool&) = delete;
+	CQueryPool& operator=(const CQueryPool&) = delete;
+
+	//Runs every query against snapshot into the result of the same index, queries handed out a few at a time
+	void Run(const CWorldSnapshot& snapshot, const std::vector<SphereQuery>& queries, std::vector<std::vector<SphereHit>>& results);
+
+	int NumThreads() const { return numThreads; }
+
+private:
+	void WorkerLoop(int worker);
+	void RunQueries();
+
+	int numThreads = 1;
+	std::vector<std::thread> threads;
+	CFrameBarrier barrier;
+	std::atomic<bool> bStopping{ false };
+
+	//The batch being run, set before the workers are released
+	const CWorldSnapshot* snapshot = nullptr;
+	const std::vector<SphereQuery>* queries = nullptr;
+	std::vector<std::vector<SphereHit>>* results = nullptr;
+	std::atomic<int> nextQuery{ 0 };
+};
+
+//Serves spatial queries against the most recently published frame.
+//The simulation publishes between frames, readers grab a snapshot and keep it for as long as they like
+//without ever blocking the simulation.
+class CSpatialQuery
+{
+public:
+	//Called by the simulation while no workers are running, both arrays must be sorted by x.
+	void Publish(const std::vector<CircleUpdateData*>& staticSpheres, const std::vector<CircleUpdateData*>& dynamicSpheres, int frame);
+
+	//Publishing split into pieces for the task graph. BeginPublish readies a snapshot of numSpheres, any number of threads
+	//then merge disjoint runs of it with PublishRange, and EndPublish makes it the current snapshot once they all have.
+	typedef std::vector<CircleUpdateData*>::const_iterator SphereIterator;
+	void BeginPublish(size_t numSpheres);
+	//Merges two x sorted runs into the snapshot from offset on and returns the largest radius among them.
+	float PublishRange(size_t offset, SphereIterator staticFirst, SphereIterator staticLast, SphereIterator dynamicFirst, SphereIterator dynamicLast);
+	void EndPublish(float maxRadius, int frame);
+
+	std::shared_ptr<const CWorldSnapshot> Snapshot() const;
+
+	//Runs every query against the same snapshot on the pool's threads. Results keep their capacity between batches.
+	void QueryBatch(const std::vector<SphereQuery>& queries, std::vector<std::vector<SphereHit>>& results, CQueryPool& pool) const;
+
+private:
+	//Only ever read and written with std::atomic_load and std::atomic_store
+	std::shared_ptr<const CWorldSnapshot> current;
+	//Being filled between BeginPublish and EndPublish
+	std::shared_ptr<CWorldSnapshot> publishing;
+	//Snapshots no reader holds any more are reused so publishing doesn't allocate every frame
+	std::vector<std::shared_ptr<CWorldSnapshot>> pool;
+};
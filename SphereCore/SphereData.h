@@ -0,0 +1,22 @@
+#pragma once
+#include "VectorMath.h"
+
+typedef vec3 vector3;
+typedef vec2 vector2;
+
+struct CircleUpdateData {
+	vector2 pos = { 0.0f, 0.0f };					//8
+	vector2 velocity = { 0.0f, 0.0f };				//16
+	float radius = 10.0f;							//20
+	int id = -1;									//24
+	int hp = 100.0f;								//28
+	int lodFrame = 0;								//32	Frame the LOD scheduler last stepped the sphere on
+};
+
+//A sphere in a 3-D world, see VolumeWorld.h. Its CircleUpdateData keeps the id and hp and is given the x and y.
+struct SphereUpdateData {
+	vector3 pos = { 0.0f, 0.0f, 0.0f };				//12
+	vector3 velocity = { 0.0f, 0.0f, 0.0f };		//24
+	float radius = 10.0f;							//28
+	int sphere = -1;								//32	Index of its CircleUpdateData in the world's dynamics
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include "TaskGraph.h"
+
+int CTaskGraph::Add(int stage, int index) {
+	Task task;
+	task.stage = stage;
+	task.index = index;
+	tasks.emplace_back(std::move(task));
+	return int(tasks.size()) - 1;
+}
+
+void CTaskGraph::Depend(int task, int dependency) {
+	tasks.at(dependency).successors.emplace_back(task);
+	tasks.at(task).numDependencies++;
+}
+
+void CTaskGraph::Clear() {
+	tasks.clear();
+}
+
+void CTaskGraph::Reset() {
+	const int numTasks = Size();
+	if (numTasks > allocated) {
+		remaining.reset(new std::atomic<int>[numTasks]);
+		ready.reset(new std::atomic<int>[numTasks]);
+		allocated = numTasks;
+	}
+
+	pushed.store(0, std::memory_order_relaxed);
+	popped.store(0, std::memory_order_relaxed);
+	completed.store(0, std::memory_order_relaxed);
+	for (int i = 0; i < numTasks; i++) {
+		remaining[i].store(tasks[i].numDependencies, std::memory_order_relaxed);
+		ready[i].store(-1, std::memory_order_relaxed);
+	}
+	//Tasks with no dependencies are ready straight away, in the order they were added
+	for (int i = 0; i < numTasks; i++) {
+		if (tasks[i].numDependencies == 0) Push(i);
+	}
+}
+
+bool CTaskGraph::TryPop(int& task) {
+	int index = popped.load(std::memory_order_relaxed);
+	while (index < pushed.load(std::memory_order_acquire)) {
+		if (popped.compare_exchange_weak(index, index + 1, std::memory_order_acq_rel)) {
+			//The slot is claimed before it's written, the pusher is only ever a few instructions behind
+			while ((task = ready[index].load(std::memory_order_acquire)) < 0) std::this_thread::yield();
+			return true;
+		}
+	}
+	return false;
+}
+
+void CTaskGraph::Push(int task) {
+	const int index = pushed.fetch_add(1, std::memory_order_acq_rel);
+	ready[index].store(task, std::memory_order_release);
+}
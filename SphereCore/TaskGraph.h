@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+
+//Fixed set of tasks with dependencies between them, built once and then run any number of times.
+//Every thread taking part calls Run, takes whichever task is ready next and hands on any task that finishes its last
+//dependency, so threads only wait when nothing at all is ready. Running the graph never touches the heap.
+class CTaskGraph
+{
+public:
+	//Tasks are a stage and an index within it, which is all Run passes back. Returns the task's id.
+	int Add(int stage, int index);
+	//task doesn't start until dependency has finished
+	void Depend(int task, int dependency);
+	void Clear();
+
+	//Readies every task for the next run. Must not overlap a run, the caller orders it before releasing other threads.
+	void Reset();
+	//Runs tasks until every task in the graph has finished, execute is called as execute(stage, index).
+	template <typename Execute>
+	void Run(Execute execute);
+
+	int Size() const { return int(tasks.size()); }
+
+private:
+	struct Task {
+		int stage;
+		int index;
+		int numDependencies = 0;
+		std::vector<int> successors;
+	};
+
+	bool TryPop(int& task);
+	void Push(int task);
+
+	std::vector<Task> tasks;
+	//Sized when the graph is reset after changing
+	int allocated = 0;
+	std::unique_ptr<std::atomic<int>[]> remaining;
+	//Ready tasks in the order they became ready, every task is pushed exactly once a run so this never wraps
+	std::unique_ptr<std::atomic<int>[]> ready;
+	std::atomic<int> pushed{ 0 };
+	std::atomic<int> popped{ 0 };
+	std::atomic<int> completed{ 0 };
+};
+
+template <typename Execute>
+void CTaskGraph::Run(Execute execute) {
+	const int numTasks = Size();
+	int idleSpins = 0;
+	//A task is only counted complete after its successors are pushed, so until everything completes there is
+	//always a task either ready or running that will make more ready
+	while (completed.load(std::memory_order_acquire) < numTasks) {
+		int task;
+		if (!TryPop(task)) {
+			if (++idleSpins > 64) std::this_thread::yield();
+			continue;
+		}
+		idleSpins = 0;
+
+		const Task& current = tasks[task];
+		execute(current.stage, current.index);
+		for (int successor : current.successors) {
+			if (remaining[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) Push(successor);
+		}
+		completed.fetch_add(1, std::memory_order_release);
+	}
+}
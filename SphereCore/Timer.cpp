@@ -1,11 +1,14 @@
 #pragma once
 #include "Timer.h"
-#include <Windows.h>
+#include <chrono>
+
+//Steady clock ticks, the clock QueryPerformanceCounter backs on Windows
+static long long Now() {
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+}
 
 Timer::Timer() : mSecondsPerCount(0.0), mFrameTime(-1.0), mBaseTime(0), mStopTime(0), mPausedTime(0), mPrevTime(0), mCurrTime(0), mPaused(false) {
-	__int64 countsPerSecond;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSecond);
-	mSecondsPerCount = 1.0 / double(countsPerSecond);
+	mSecondsPerCount = double(std::chrono::steady_clock::period::num) / double(std::chrono::steady_clock::period::den);
 }
 
 void Timer::Tick()
@@ -15,9 +18,7 @@ void Timer::Tick()
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-	mCurrTime = currTime;
+	mCurrTime = Now();
 	mFrameTime = (mCurrTime - mPrevTime) * mSecondsPerCount;
 	mPrevTime = mCurrTime;
 	if (mFrameTime < 0.0) mFrameTime = 0.0;
@@ -25,8 +26,7 @@ void Timer::Tick()
 
 void Timer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	long long currTime = Now();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
@@ -36,8 +36,7 @@ void Timer::Reset()
 
 void Timer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	long long startTime = Now();
 	if (mPaused) {
 		mPausedTime += (startTime - mStopTime);
 		mPrevTime = startTime;
@@ -49,9 +48,7 @@ void Timer::Start()
 void Timer::Stop()
 {
 	if (!mPaused) {
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-		mStopTime = currTime;
+		mStopTime = Now();
 		mPaused = true;
 	}
 }
@@ -16,11 +16,11 @@ private:
 	bool mPaused;
 	double mSecondsPerCount;
 	double mFrameTime;
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	long long mBaseTime;
+	long long mPausedTime;
+	long long mStopTime;
+	long long mPrevTime;
+	long long mCurrTime;
 
 };
 
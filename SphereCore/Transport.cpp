@@ -0,0 +1,147 @@
+#pragma once
+#include "Transport.h"
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+SocketTransport::SocketTransport(int Rank, int NumRanks, int LeftSocket, int RightSocket)
+{
+	rank = Rank;
+	numRanks = NumRanks;
+	leftSocket = LeftSocket;
+	rightSocket = RightSocket;
+}
+
+SocketTransport::~SocketTransport()
+{
+#ifndef _WIN32
+	if (leftSocket >= 0) close(leftSocket);
+	if (rightSocket >= 0) close(rightSocket);
+	//Closed first so a child still waiting on an exchange sees the connection go and stops
+	for (int child : children) waitpid(pid_t(child), nullptr, 0);
+#endif
+}
+
+SocketTransport* SocketTransport::LaunchLocal(int numRanks)
+{
+#ifdef _WIN32
+	return nullptr;
+#else
+	if (numRanks < 1) return nullptr;
+
+	//Socket pair i links rank i to rank i + 1
+	std::vector<int> leftEnds;
+	std::vector<int> rightEnds;
+	for (int i = 0; i < numRanks - 1; i++) {
+		int pair[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) return nullptr;
+		leftEnds.emplace_back(pair[0]);
+		rightEnds.emplace_back(pair[1]);
+	}
+
+	//Anything buffered would otherwise be written again by every child
+	fflush(stdout);
+	int rank = 0;
+	std::vector<int> children;
+	for (int i = 1; i < numRanks; i++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			//Ranks already forked stop at their first exchange once these ends are gone
+			for (int pair = 0; pair < numRanks - 1; pair++) {
+				close(leftEnds.at(pair));
+				close(rightEnds.at(pair));
+			}
+			for (int child : children) waitpid(pid_t(child), nullptr, 0);
+			return nullptr;
+		}
+		if (pid == 0) {
+			rank = i;
+			children.clear();
+			break;
+		}
+		children.emplace_back(int(pid));
+	}
+
+	//Closes the ends belonging to other ranks
+	int leftSocket = -1;
+	int rightSocket = -1;
+	for (int i = 0; i < numRanks - 1; i++) {
+		if (i == rank - 1) leftSocket = rightEnds.at(i);
+		else close(rightEnds.at(i));
+		if (i == rank) rightSocket = leftEnds.at(i);
+		else close(leftEnds.at(i));
+	}
+	SocketTransport* transport = new SocketTransport(rank, numRanks, leftSocket, rightSocket);
+	transport->children = children;
+	return transport;
+#endif
+}
+
+bool SocketTransport::Exchange(int otherRank, const std::vector<CircleUpdateData>& outgoing, std::vector<CircleUpdateData>& incoming)
+{
+	int socket = -1;
+	if (otherRank == rank - 1) socket = leftSocket;
+	else if (otherRank == rank + 1) socket = rightSocket;
+	if (socket < 0) return false;
+
+	//Lower rank sends first so a pair never blocks sending into each other's full buffers
+	if (rank < otherRank) return Send(socket, outgoing) && Receive(socket, incoming);
+	else return Receive(socket, incoming) && Send(socket, outgoing);
+}
+
+bool SocketTransport::Send(int socket, const std::vector<CircleUpdateData>& outgoing)
+{
+#ifdef _WIN32
+	return false;
+#else
+	unsigned int count = static_cast<unsigned int>(outgoing.size());
+	const char* header = reinterpret_cast<const char*>(&count);
+	size_t sent = 0;
+	while (sent < sizeof(count)) {
+		ssize_t result = write(socket, header + sent, sizeof(count) - sent);
+		if (result <= 0) return false;
+		sent += result;
+	}
+
+	const char* data = reinterpret_cast<const char*>(outgoing.data());
+	const size_t size = outgoing.size() * sizeof(CircleUpdateData);
+	sent = 0;
+	while (sent < size) {
+		ssize_t result = write(socket, data + sent, size - sent);
+		if (result <= 0) return false;
+		sent += result;
+	}
+	return true;
+#endif
+}
+
+bool SocketTransport::Receive(int socket, std::vector<CircleUpdateData>& incoming)
+{
+#ifdef _WIN32
+	return false;
+#else
+	unsigned int count = 0;
+	char* header = reinterpret_cast<char*>(&count);
+	size_t received = 0;
+	while (received < sizeof(count)) {
+		ssize_t result = read(socket, header + received, sizeof(count) - received);
+		if (result <= 0) return false;
+		received += result;
+	}
+
+	incoming.resize(count);
+	char* data = reinterpret_cast<char*>(incoming.data());
+	const size_t size = size_t(count) * sizeof(CircleUpdateData);
+	received = 0;
+	while (received < size) {
+		ssize_t result = read(socket, data + received, size - received);
+		if (result <= 0) return false;
+		received += result;
+	}
+	return true;
+#endif
+}
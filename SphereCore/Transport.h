@@ -0,0 +1,47 @@
+#pragma once
+#include "SphereData.h"
+#include <vector>
+
+//Moves spheres between the processes of a domain decomposed simulation.
+//Ranks own neighbouring x slabs, rank 0 being the leftmost.
+class ITransport
+{
+public:
+	virtual ~ITransport() {}
+
+	virtual int Rank() const = 0;
+	virtual int NumRanks() const = 0;
+
+	//Sends outgoing to the given rank and receives that rank's spheres into incoming.
+	//Both sides must call Exchange with each other for it to complete.
+	virtual bool Exchange(int rank, const std::vector<CircleUpdateData>& outgoing, std::vector<CircleUpdateData>& incoming) = 0;
+};
+
+//Local transport, each rank is a forked process connected to its neighbours with Unix domain sockets.
+//Only available on POSIX platforms.
+class SocketTransport : public ITransport
+{
+public:
+	~SocketTransport();
+
+	//Forks numRanks - 1 child processes and returns the transport for whichever process is calling.
+	//Returns nullptr if processes can't be created on this platform. Rank 0's transport waits for the others to exit when destroyed.
+	static SocketTransport* LaunchLocal(int numRanks);
+
+	int Rank() const override { return rank; }
+	int NumRanks() const override { return numRanks; }
+	bool Exchange(int rank, const std::vector<CircleUpdateData>& outgoing, std::vector<CircleUpdateData>& incoming) override;
+
+private:
+	SocketTransport(int rank, int numRanks, int leftSocket, int rightSocket);
+
+	bool Send(int socket, const std::vector<CircleUpdateData>& outgoing);
+	bool Receive(int socket, std::vector<CircleUpdateData>& incoming);
+
+	int rank = 0;
+	int numRanks = 1;
+	int leftSocket = -1;
+	int rightSocket = -1;
+	//Processes rank 0 forked, waited for when it's destroyed
+	std::vector<int> children;
+};
@@ -0,0 +1,181 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+
+//Header only so every operator inlines into the collision code without link time optimisation.
+//Scalar vec2/vec3 for per sphere maths, floatx8/vec2x8 for eight spheres at a time in structure of arrays form.
+//The batch types map onto AVX, SSE, NEON or plain arrays depending on what the compiler targets.
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VECTORMATH_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VECTORMATH_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VECTORMATH_NEON
+#endif
+
+struct vec2 {
+	float x;
+	float y;
+};
+
+constexpr vec2 operator+ (const vec2& a, const vec2& b) { return { a.x + b.x, a.y + b.y }; }
+constexpr vec2 operator- (const vec2& a, const vec2& b) { return { a.x - b.x, a.y - b.y }; }
+constexpr vec2 operator- (const vec2& a) { return { -a.x, -a.y }; }
+constexpr vec2 operator* (const vec2& a, float b) { return { a.x * b, a.y * b }; }
+constexpr vec2 operator* (float b, const vec2& a) { return { a.x * b, a.y * b }; }
+constexpr vec2 operator/ (const vec2& a, float b) { return { a.x / b, a.y / b }; }
+inline vec2& operator+= (vec2& a, const vec2& b) { a.x += b.x; a.y += b.y; return a; }
+inline vec2& operator-= (vec2& a, const vec2& b) { a.x -= b.x; a.y -= b.y; return a; }
+inline vec2& operator*= (vec2& a, float b) { a.x *= b; a.y *= b; return a; }
+constexpr float Dot(const vec2& a, const vec2& b) { return a.x * b.x + a.y * b.y; }
+constexpr float LengthSq(const vec2& a) { return Dot(a, a); }
+inline float Length(const vec2& a) { return std::sqrt(LengthSq(a)); }
+
+struct vec3 {
+	float x;
+	float y;
+	float z;
+};
+
+constexpr vec3 operator+ (const vec3& a, const vec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+constexpr vec3 operator- (const vec3& a, const vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+constexpr vec3 operator- (const vec3& a) { return { -a.x, -a.y, -a.z }; }
+constexpr vec3 operator* (const vec3& a, float b) { return { a.x * b, a.y * b, a.z * b }; }
+constexpr vec3 operator* (float b, const vec3& a) { return { a.x * b, a.y * b, a.z * b }; }
+constexpr vec3 operator/ (const vec3& a, float b) { return { a.x / b, a.y / b, a.z / b }; }
+inline vec3& operator+= (vec3& a, const vec3& b) { a.x += b.x; a.y += b.y; a.z += b.z; return a; }
+inline vec3& operator-= (vec3& a, const vec3& b) { a.x -= b.x; a.y -= b.y; a.z -= b.z; return a; }
+inline vec3& operator*= (vec3& a, float b) { a.x *= b; a.y *= b; a.z *= b; return a; }
+constexpr float Dot(const vec3& a, const vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+constexpr float LengthSq(const vec3& a) { return Dot(a, a); }
+inline float Length(const vec3& a) { return std::sqrt(LengthSq(a)); }
+constexpr vec3 Cross(const vec3& a, const vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+inline vec3 Normalise(const vec3& a) { return a / Length(a); }
+
+//Eight floats in whatever registers the target has. Comparisons return lanes of all ones or all zeros.
+struct floatx8 {
+	static const int WIDTH = 8;
+#if defined(VECTORMATH_AVX)
+	__m256 v;
+#elif defined(VECTORMATH_SSE)
+	__m128 lo, hi;
+#elif defined(VECTORMATH_NEON)
+	float32x4_t lo, hi;
+#else
+	float v[8];
+#endif
+
+	static floatx8 Load(const float* p) {
+		floatx8 r;
+#if defined(VECTORMATH_AVX)
+		r.v = _mm256_loadu_ps(p);
+#elif defined(VECTORMATH_SSE)
+		r.lo = _mm_loadu_ps(p); r.hi = _mm_loadu_ps(p + 4);
+#elif defined(VECTORMATH_NEON)
+		r.lo = vld1q_f32(p); r.hi = vld1q_f32(p + 4);
+#else
+		for (int i = 0; i < 8; i++) r.v[i] = p[i];
+#endif
+		return r;
+	}
+
+	static floatx8 Broadcast(float f) {
+		floatx8 r;
+#if defined(VECTORMATH_AVX)
+		r.v = _mm256_set1_ps(f);
+#elif defined(VECTORMATH_SSE)
+		r.lo = r.hi = _mm_set1_ps(f);
+#elif defined(VECTORMATH_NEON)
+		r.lo = r.hi = vdupq_n_f32(f);
+#else
+		for (int i = 0; i < 8; i++) r.v[i] = f;
+#endif
+		return r;
+	}
+
+	void Store(float* p) const {
+#if defined(VECTORMATH_AVX)
+		_mm256_storeu_ps(p, v);
+#elif defined(VECTORMATH_SSE)
+		_mm_storeu_ps(p, lo); _mm_storeu_ps(p + 4, hi);
+#elif defined(VECTORMATH_NEON)
+		vst1q_f32(p, lo); vst1q_f32(p + 4, hi);
+#else
+		for (int i = 0; i < 8; i++) p[i] = v[i];
+#endif
+	}
+};
+
+#if defined(VECTORMATH_AVX)
+#define VECTORMATH_LANEWISE(name, avx, sse, neon, scalar) \
+	inline floatx8 name(const floatx8& a, const floatx8& b) { floatx8 r; r.v = avx(a.v, b.v); return r; }
+#elif defined(VECTORMATH_SSE)
+#define VECTORMATH_LANEWISE(name, avx, sse, neon, scalar) \
+	inline floatx8 name(const floatx8& a, const floatx8& b) { floatx8 r; r.lo = sse(a.lo, b.lo); r.hi = sse(a.hi, b.hi); return r; }
+#elif defined(VECTORMATH_NEON)
+#define VECTORMATH_LANEWISE(name, avx, sse, neon, scalar) \
+	inline floatx8 name(const floatx8& a, const floatx8& b) { floatx8 r; r.lo = neon(a.lo, b.lo); r.hi = neon(a.hi, b.hi); return r; }
+#else
+#define VECTORMATH_LANEWISE(name, avx, sse, neon, scalar) \
+	inline floatx8 name(const floatx8& a, const floatx8& b) { floatx8 r; for (int i = 0; i < 8; i++) { const float x = a.v[i], y = b.v[i]; r.v[i] = scalar; } return r; }
+#endif
+
+VECTORMATH_LANEWISE(operator+, _mm256_add_ps, _mm_add_ps, vaddq_f32, x + y)
+VECTORMATH_LANEWISE(operator-, _mm256_sub_ps, _mm_sub_ps, vsubq_f32, x - y)
+VECTORMATH_LANEWISE(operator*, _mm256_mul_ps, _mm_mul_ps, vmulq_f32, x * y)
+VECTORMATH_LANEWISE(Min, _mm256_min_ps, _mm_min_ps, vminq_f32, x < y ? x : y)
+VECTORMATH_LANEWISE(Max, _mm256_max_ps, _mm_max_ps, vmaxq_f32, x > y ? x : y)
+#undef VECTORMATH_LANEWISE
+
+inline floatx8 LessEqual(const floatx8& a, const floatx8& b) {
+	floatx8 r;
+#if defined(VECTORMATH_AVX)
+	r.v = _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ);
+#elif defined(VECTORMATH_SSE)
+	r.lo = _mm_cmple_ps(a.lo, b.lo); r.hi = _mm_cmple_ps(a.hi, b.hi);
+#elif defined(VECTORMATH_NEON)
+	r.lo = vreinterpretq_f32_u32(vcleq_f32(a.lo, b.lo)); r.hi = vreinterpretq_f32_u32(vcleq_f32(a.hi, b.hi));
+#else
+	for (int i = 0; i < 8; i++) {
+		const unsigned bits = a.v[i] <= b.v[i] ? 0xffffffffu : 0u;
+		std::memcpy(&r.v[i], &bits, sizeof(float));
+	}
+#endif
+	return r;
+}
+
+//Number of lanes set in a comparison result.
+inline int CountTrue(const floatx8& mask) {
+#if defined(VECTORMATH_AVX)
+	const int bits = _mm256_movemask_ps(mask.v);
+#elif defined(VECTORMATH_SSE)
+	const int bits = _mm_movemask_ps(mask.lo) | (_mm_movemask_ps(mask.hi) << 4);
+#else
+	float lanes[8];
+	mask.Store(lanes);
+	int bits = 0;
+	for (int i = 0; i < 8; i++) bits |= std::signbit(lanes[i]) ? 1 << i : 0;
+#endif
+	int count = 0;
+	for (int b = bits; b != 0; b &= b - 1) count++;
+	return count;
+}
+
+//Eight vec2s split into x and y registers.
+struct vec2x8 {
+	floatx8 x;
+	floatx8 y;
+
+	static vec2x8 Load(const float* xs, const float* ys) { return { floatx8::Load(xs), floatx8::Load(ys) }; }
+	static vec2x8 Broadcast(const vec2& a) { return { floatx8::Broadcast(a.x), floatx8::Broadcast(a.y) }; }
+};
+
+inline vec2x8 operator+ (const vec2x8& a, const vec2x8& b) { return { a.x + b.x, a.y + b.y }; }
+inline vec2x8 operator- (const vec2x8& a, const vec2x8& b) { return { a.x - b.x, a.y - b.y }; }
+inline vec2x8 operator* (const vec2x8& a, const floatx8& b) { return { a.x * b, a.y * b }; }
+inline floatx8 Dot(const vec2x8& a, const vec2x8& b) { return a.x * b.x + a.y * b.y; }
+inline floatx8 LengthSq(const vec2x8& a) { return Dot(a, a); }
@@ -0,0 +1,273 @@
+#pragma once
+#include "VolumeWorld.h"
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+//Bits of a cell key per axis, cell coordinates are kept inside them
+const int VOLUME_COORD_BITS = 21;
+const int MAX_VOLUME_COORD = (1 << (VOLUME_COORD_BITS - 1)) - 1;
+
+//Same response as the 2-D kernels' CollisionDetection: pushed straight away from the static by half the overlap, keeping its speed
+static void CollideSpheres(const vector3 staticPos, float staticRadius, SphereUpdateData& sphere) {
+	const vector3 vectBetweenSpheres = staticPos - sphere.pos;
+	const float vectDist = Length(vectBetweenSpheres);
+	const float sphereRadiusCombined = staticRadius + sphere.radius;
+	//Coincident centres give no direction to push out along
+	if (!(vectDist <= sphereRadiusCombined && vectDist > 0.0f)) return;
+
+	const vector3 normVectorBetweenSpheres = vectBetweenSpheres / vectDist;
+	const float dotSpheresVectorNormVector = Dot(vectBetweenSpheres, normVectorBetweenSpheres);
+	const vector3 reflectedDynamicMomentum = vectBetweenSpheres - 2 * dotSpheresVectorNormVector * normVectorBetweenSpheres;
+	const vector3 normReflectedVec = reflectedDynamicMomentum / Length(reflectedDynamicMomentum);
+
+	const float momentumDist = Length(sphere.velocity);
+	sphere.pos = sphere.pos + normReflectedVec * ((sphereRadiusCombined - vectDist + 0.1f) * 0.5f);
+	sphere.velocity = normReflectedVec * momentumDist;
+}
+
+//Whether a static is one the dynamic collides with this frame, tested where the dynamic moved to before any collision
+static bool Overlaps(const vector3 staticPos, float staticRadius, vector3 dynamicPos, float dynamicRadius) {
+	const float reach = staticRadius + dynamicRadius;
+	return LengthSq(staticPos - dynamicPos) <= reach * reach;
+}
+
+//Jacobi resolution over the contacts in order, every correction worked out from where the dynamic moved to
+static void ResolveJacobi(const vector3* contactPos, const float* contactRadius, int numContacts, SphereUpdateData& sphere) {
+	const vector3 dynamicPos = sphere.pos;
+	vector3 pushTotal = { 0.0f, 0.0f, 0.0f };
+	vector3 awayTotal = { 0.0f, 0.0f, 0.0f };
+	int numPushes = 0;
+	for (int c = 0; c < numContacts; c++) {
+		const vector3 between = dynamicPos - contactPos[c];
+		const float vectDist = Length(between);
+		if (vectDist <= 0.0f) continue;
+		pushTotal = pushTotal + (between / vectDist) * ((contactRadius[c] + sphere.radius - vectDist + 0.1f) * 0.5f);
+		awayTotal = awayTotal + between / vectDist;
+		numPushes++;
+	}
+	if (numPushes == 0) return;
+	const float awayDist = Length(awayTotal);
+	const float momentumDist = Length(sphere.velocity);
+	sphere.pos = dynamicPos + pushTotal / float(numPushes);
+	if (awayDist > 0.0f) sphere.velocity = (awayTotal / awayDist) * momentumDist;
+}
+
+CVolumeWorld* CVolumeWorld::Create(const SimulationConfig& config, const std::vector<CircleUpdateData*>& Statics, const std::vector<CircleUpdateData*>& Dynamics) {
+	if (config.dimensions != 3) return nullptr;
+	CVolumeWorld* world = new CVolumeWorld(config);
+
+	//Depths come from their own generator so the spheres' x and y are what the 2-D world would have from the same seed
+	std::default_random_engine gen;
+	gen.seed(config.seed + 1);
+	std::uniform_real_distribution<> zPosDistribution(config.zMinCoord, config.zMaxCoord);
+	std::uniform_real_distribution<> zVelocDistribution(config.zVelocityNegLimit, config.zVelocityPosLimit);
+
+	world->statics.reserve(Statics.size());
+	world->staticDepths.reserve(Statics.size());
+	for (auto sphere : Statics) {
+		const float z = float(zPosDistribution(gen));
+		world->statics.push_back({ { sphere->pos.x, sphere->pos.y, z }, sphere->radius });
+		world->staticDepths.emplace_back(z);
+	}
+	world->spheres.assign(Dynamics.begin(), Dynamics.end());
+	world->dynamics.resize(Dynamics.size());
+	for (size_t i = 0; i < Dynamics.size(); i++) {
+		SphereUpdateData& sphere = world->dynamics.at(i);
+		sphere.pos = { Dynamics.at(i)->pos.x, Dynamics.at(i)->pos.y, float(zPosDistribution(gen)) };
+		sphere.velocity = { Dynamics.at(i)->velocity.x, Dynamics.at(i)->velocity.y, float(zVelocDistribution(gen)) };
+		sphere.radius = Dynamics.at(i)->radius;
+		sphere.sphere = int(i);
+	}
+	std::sort(world->dynamics.begin(), world->dynamics.end(), [](const SphereUpdateData& a, const SphereUpdateData& b) { return a.pos.x < b.pos.x; });
+
+	//Statics are packed cell by cell, in their given order within a cell
+	std::vector<std::pair<uint64_t, int>> entries;
+	entries.reserve(world->statics.size());
+	for (int i = 0; i < int(world->statics.size()); i++) entries.emplace_back(world->KeyOf(world->statics[i].pos), i);
+	std::sort(entries.begin(), entries.end());
+	for (int i = 0; i < int(entries.size()); i++) {
+		world->packed.emplace_back(world->statics[entries[i].second]);
+		world->packedIndex.emplace_back(entries[i].second);
+		if (i > 0 && entries[i].first == entries[i - 1].first) world->cells.back().end = i + 1;
+		else world->cells.push_back({ entries[i].first, i, i + 1 });
+	}
+
+	world->slotBits = 1;
+	while ((size_t(1) << world->slotBits) < world->cells.size() * 2) world->slotBits++;
+	world->slots.assign(size_t(1) << world->slotBits, -1);
+	const size_t mask = world->slots.size() - 1;
+	for (int c = 0; c < int(world->cells.size()); c++) {
+		size_t i = world->Home(world->cells[c].key);
+		while (world->slots[i] >= 0) i = (i + 1) & mask;
+		world->slots[i] = c;
+	}
+	return world;
+}
+
+CVolumeWorld::CVolumeWorld(const SimulationConfig& Config) : config(Config) {
+	//Wider than any dynamic's reach across, so a query spans at most two cells on each axis. Wider still gathers more statics
+	//than the lookups it saves.
+	cellSize = 6.0f * config.MaxRadius();
+	inverseCellSize = 1.0 / cellSize;
+}
+
+void CVolumeWorld::Sort() {
+	for (size_t i = 1; i < dynamics.size(); i++) {
+		if (!(dynamics[i].pos.x < dynamics[i - 1].pos.x)) continue;
+		const SphereUpdateData sphere = dynamics[i];
+		size_t j = i;
+		for (; j > 0 && sphere.pos.x < dynamics[j - 1].pos.x; j--) dynamics[j] = dynamics[j - 1];
+		dynamics[j] = sphere;
+	}
+}
+
+void CVolumeWorld::Update(int start, int amount, float frameTime, CFrameArena& arena) {
+	const float maxRadius = config.MaxRadius();
+	int* candidates = nullptr;
+	int capacity = 0;
+	//Gathered for Jacobi resolution
+	vector3* contactPos = nullptr;
+	float* contactRadius = nullptr;
+
+	for (int i = 0; i < amount; i++) {
+		SphereUpdateData& sphere = dynamics[start + i];
+		sphere.pos = sphere.pos + sphere.velocity * frameTime;
+		const vector3 dynamicPos = sphere.pos;
+		const float reach = sphere.radius + maxRadius;
+		const int minX = Coord(dynamicPos.x - reach), maxX = Coord(dynamicPos.x + reach);
+		const int minY = Coord(dynamicPos.y - reach), maxY = Coord(dynamicPos.y + reach);
+		const int minZ = Coord(dynamicPos.z - reach), maxZ = Coord(dynamicPos.z + reach);
+
+		int count = 0;
+		for (int z = minZ; z <= maxZ; z++) {
+			for (int y = minY; y <= maxY; y++) {
+				for (int x = minX; x <= maxX; x++) {
+					const Cell* cell = Find(Key(x, y, z));
+					if (cell == nullptr) continue;
+					for (int s = cell->begin; s < cell->end; s++) {
+						if (!Overlaps(packed[s].pos, packed[s].radius, dynamicPos, sphere.radius)) continue;
+						if (count == capacity) {
+							//Regrown in the arena, the old buffer is left until it's reset
+							capacity = std::max(capacity * 2, 32);
+							int* grown = arena.Allocate<int>(capacity);
+							std::copy(candidates, candidates + count, grown);
+							candidates = grown;
+							contactPos = arena.Allocate<vector3>(capacity);
+							contactRadius = arena.Allocate<float>(capacity);
+						}
+						candidates[count++] = packedIndex[s];
+					}
+				}
+			}
+		}
+
+		if (count > 0) {
+			//Back into the statics' order, there are only ever a few
+			for (int a = 1; a < count; a++) {
+				const int candidate = candidates[a];
+				int b = a;
+				for (; b > 0 && candidates[b - 1] > candidate; b--) candidates[b] = candidates[b - 1];
+				candidates[b] = candidate;
+			}
+			if (config.jacobiResolution) {
+				for (int c = 0; c < count; c++) {
+					contactPos[c] = statics[candidates[c]].pos;
+					contactRadius[c] = statics[candidates[c]].radius;
+				}
+				ResolveJacobi(contactPos, contactRadius, count, sphere);
+			}
+			else {
+				for (int c = 0; c < count; c++) CollideSpheres(statics[candidates[c]].pos, statics[candidates[c]].radius, sphere);
+			}
+		}
+
+		ApplyBounds(sphere);
+	}
+}
+
+void CVolumeWorld::UpdateReference(int start, int amount, float frameTime) {
+	std::vector<vector3> contactPos;
+	std::vector<float> contactRadius;
+
+	for (int i = 0; i < amount; i++) {
+		SphereUpdateData& sphere = dynamics[start + i];
+		sphere.pos = sphere.pos + sphere.velocity * frameTime;
+		const vector3 dynamicPos = sphere.pos;
+
+		contactPos.clear();
+		contactRadius.clear();
+		for (const auto& staticSphere : statics) {
+			if (!Overlaps(staticSphere.pos, staticSphere.radius, dynamicPos, sphere.radius)) continue;
+			if (config.jacobiResolution) {
+				contactPos.emplace_back(staticSphere.pos);
+				contactRadius.emplace_back(staticSphere.radius);
+			}
+			else CollideSpheres(staticSphere.pos, staticSphere.radius, sphere);
+		}
+		if (!contactPos.empty()) ResolveJacobi(contactPos.data(), contactRadius.data(), int(contactPos.size()), sphere);
+
+		ApplyBounds(sphere);
+	}
+}
+
+void CVolumeWorld::Gather(std::vector<CircleUpdateData*>& Dynamics) const {
+	Dynamics.clear();
+	for (const auto& sphere : dynamics) {
+		CircleUpdateData* flat = spheres[sphere.sphere];
+		flat->pos = { sphere.pos.x, sphere.pos.y };
+		flat->velocity = { sphere.velocity.x, sphere.velocity.y };
+		Dynamics.emplace_back(flat);
+	}
+}
+
+//Positions past the coordinate limit share the outermost cells, NaNs go to the lowest
+int CVolumeWorld::Coord(float position) const {
+	const double coord = std::floor(double(position) * inverseCellSize);
+	if (!(coord > -MAX_VOLUME_COORD)) return -MAX_VOLUME_COORD;
+	if (coord > MAX_VOLUME_COORD) return MAX_VOLUME_COORD;
+	return int(coord);
+}
+
+uint64_t CVolumeWorld::Key(int x, int y, int z) {
+	const uint64_t mask = (uint64_t(1) << VOLUME_COORD_BITS) - 1;
+	return (uint64_t(z) & mask) << (2 * VOLUME_COORD_BITS) | (uint64_t(y) & mask) << VOLUME_COORD_BITS | (uint64_t(x) & mask);
+}
+
+size_t CVolumeWorld::Home(uint64_t key) const {
+	//Neighbouring cells make lattices of keys that a single multiply lines up in runs, so the bits are mixed first
+	key = (key ^ (key >> 33)) * 0xFF51AFD7ED558CCDull;
+	key = (key ^ (key >> 33)) * 0xC4CEB9FE1A85EC53ull;
+	return size_t(key >> (64 - slotBits));
+}
+
+const CVolumeWorld::Cell* CVolumeWorld::Find(uint64_t key) const {
+	const size_t mask = slots.size() - 1;
+	for (size_t i = Home(key); slots[i] >= 0; i = (i + 1) & mask) {
+		if (cells[slots[i]].key == key) return &cells[slots[i]];
+	}
+	return nullptr;
+}
+
+//Per axis, as the 2-D kernels' bounds do it for x and y
+void CVolumeWorld::ApplyBounds(SphereUpdateData& sphere) const {
+	auto axis = [&](float& pos, float& velocity, float min, float max) {
+		if (config.bounds == EBounds::Reflective) {
+			if (pos >= max) {
+				pos = max;
+				velocity = -velocity;
+			}
+			else if (pos <= min) {
+				pos = min;
+				velocity = -velocity;
+			}
+		}
+		else if (config.bounds == EBounds::Wrap) {
+			if (pos >= max) pos -= max - min;
+			else if (pos < min) pos += max - min;
+		}
+	};
+	axis(sphere.pos.x, sphere.velocity.x, config.xMinCoord, config.xMaxCoord);
+	axis(sphere.pos.y, sphere.velocity.y, config.yMinCoord, config.yMaxCoord);
+	axis(sphere.pos.z, sphere.velocity.z, config.zMinCoord, config.zMaxCoord);
+}
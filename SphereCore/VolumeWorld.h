@@ -0,0 +1,75 @@
+#pragma once
+#include "SphereData.h"
+#include "SimulationConfig.h"
+#include "FrameArena.h"
+#include <vector>
+#include <cstdint>
+
+//The world as spheres in a box instead of circles on a plane, for volumetric workloads. Every sphere is given a z and a z
+//velocity on top of the x and y the 2-D setup drew, so a 3-D world holds the 2-D world's spheres from the same seed.
+//A sweep along one axis gathers more statics the deeper the world is, so statics are binned once into a uniform grid of
+//cells three of the largest spheres across, only occupied cells stored and found through a hash. A dynamic only has to
+//look through at most the eight cells around it. Each dynamic collides with the statics it overlaps after moving, in the order
+//the statics are sorted in, with the 2-D kernels' response in three dimensions. Dynamics don't depend on each other so a
+//world steps identically however it's split. The dynamics' CircleUpdateData keep their x and y for everything that reads
+//the world flat, brought up to date when something reads them.
+class CVolumeWorld
+{
+public:
+	//Returns nullptr unless the config has 3 dimensions. statics and dynamics must outlive the world.
+	static CVolumeWorld* Create(const SimulationConfig& config, const std::vector<CircleUpdateData*>& statics, const std::vector<CircleUpdateData*>& dynamics);
+
+	int NumDynamics() const { return int(dynamics.size()); }
+	//Sorts the dynamics by x so neighbours look through some of the same cells, mostly sorted already so close to a single pass
+	void Sort();
+	//Steps dynamics start to start + amount - 1 in sorted order. Threads may update separate ranges at once.
+	void Update(int start, int amount, float frameTime, CFrameArena& arena);
+	//Steps them testing every static with no grid, Update should land in exactly the same place
+	void UpdateReference(int start, int amount, float frameTime);
+	//Writes the dynamics' x and y back to their spheres and fills dynamics with them in the order they were last sorted in
+	void Gather(std::vector<CircleUpdateData*>& dynamics) const;
+
+	const std::vector<SphereUpdateData>& DynamicSpheres() const { return dynamics; }
+	//z of each static, in the order the statics were given
+	const std::vector<float>& StaticDepths() const { return staticDepths; }
+	float CellSize() const { return cellSize; }
+	int NumCells() const { return int(cells.size()); }
+
+private:
+	struct StaticSphere {
+		vector3 pos;
+		float radius;
+	};
+	struct Cell {
+		uint64_t key;
+		int begin;
+		int end;
+	};
+
+	CVolumeWorld(const SimulationConfig& config);
+
+	int Coord(float position) const;
+	static uint64_t Key(int x, int y, int z);
+	uint64_t KeyOf(vector3 pos) const { return Key(Coord(pos.x), Coord(pos.y), Coord(pos.z)); }
+	size_t Home(uint64_t key) const;
+	const Cell* Find(uint64_t key) const;
+	void ApplyBounds(SphereUpdateData& sphere) const;
+
+	SimulationConfig config;
+	float cellSize = 0.0f;
+	double inverseCellSize = 0.0;
+
+	//Statics in their given order, which sets the order a dynamic collides with them in
+	std::vector<StaticSphere> statics;
+	std::vector<float> staticDepths;
+	//Statics packed cell by cell along with where each is in statics
+	std::vector<StaticSphere> packed;
+	std::vector<int> packedIndex;
+	std::vector<Cell> cells;
+	//Open addressed with linear probing, a power of two in size and at most half full
+	std::vector<int> slots;
+	int slotBits = 0;
+
+	std::vector<SphereUpdateData> dynamics;
+	std::vector<CircleUpdateData*> spheres;
+};
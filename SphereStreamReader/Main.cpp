@@ -0,0 +1,114 @@
+#pragma once
+#include "FrameStream.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+//Reference reader for the shared memory frame stream. Follows the latest frame as the simulation writes it and checks
+//every frame it reads is whole, reading in place without copying any of it.
+//	SphereStreamReader [--name NAME] [--frames N]		stops after N frames, runs until the stream goes away otherwise
+//Returns non-zero if any frame the writer had finished failed its checks.
+
+//How long to wait for the simulation to create the stream before giving up
+const int OPEN_TIMEOUT_SECONDS = 10;
+
+struct ReadStats {
+	int framesRead = 0;
+	//Frames the writer finished that this reader never saw, a slow reader skips rather than holds the writer up
+	long long framesSkipped = 0;
+	//Frames the writer came back round to while they were being read, thrown away and not counted as failures
+	int framesTorn = 0;
+	int framesFailed = 0;
+};
+
+//Checksum and ids, every static and every dynamic id must be in range and appear once. Returns an empty string if fine.
+std::string CheckFrame(const StreamFrame& frame, int capacity, std::vector<int>& seenFrame) {
+	if (frame.numStatics < 0 || frame.numDynamics < 0 || frame.numStatics + frame.numDynamics > capacity) return "sphere counts out of range";
+	if (StreamChecksum(frame) != frame.checksum) return "checksum mismatch";
+
+	//Statics and dynamics number their ids separately, stamps are the frame's sequence plus which half
+	const int stamps[2] = { int(frame.sequence * 2), int(frame.sequence * 2 + 1) };
+	const int counts[2] = { frame.numStatics, frame.numDynamics };
+	int index = 0;
+	for (int half = 0; half < 2; half++) {
+		for (int i = 0; i < counts[half]; i++, index++) {
+			const int id = frame.id[index];
+			if (id < 0 || id >= capacity) return "id out of range";
+			if (seenFrame.at(half * capacity + id) == stamps[half]) return "repeated id";
+			seenFrame.at(half * capacity + id) = stamps[half];
+		}
+	}
+	return "";
+}
+
+int main(int argc, char** argv) {
+	std::string name = "/SphereAssignment2D";
+	int numFrames = -1;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool bHasValue = i + 1 < argc;
+		if (arg == "--name" && bHasValue) name = argv[++i];
+		else if (arg == "--frames" && bHasValue) numFrames = std::stoi(argv[++i]);
+		else {
+			std::cout << "Unknown argument " << arg << "\n";
+			return 1;
+		}
+	}
+
+	CFrameStreamReader* reader = nullptr;
+	auto openStart = std::chrono::steady_clock::now();
+	while ((reader = CFrameStreamReader::Open(name.c_str())) == nullptr) {
+		if (std::chrono::steady_clock::now() - openStart > std::chrono::seconds(OPEN_TIMEOUT_SECONDS)) {
+			std::cout << "No frame stream " << name << " to read\n";
+			return 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+	std::cout << "Reading " << name << ", " << reader->NumSlots() << " slots of up to " << reader->Capacity() << " spheres\n";
+
+	ReadStats stats;
+	std::vector<int> seenFrame(size_t(reader->Capacity()) * 2, -1);
+	uint64_t lastSequence = 0;
+	auto lastFrameTime = std::chrono::steady_clock::now();
+	auto reportTime = lastFrameTime;
+	while (numFrames < 0 || stats.framesRead < numFrames) {
+		StreamFrame frame;
+		const auto now = std::chrono::steady_clock::now();
+		if (!reader->Latest(frame) || frame.sequence == lastSequence) {
+			//A writer gone quiet for this long has most likely exited, its shared memory stays mapped here regardless
+			if (now - lastFrameTime > std::chrono::seconds(OPEN_TIMEOUT_SECONDS)) {
+				std::cout << "Stream stopped updating\n";
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		lastFrameTime = now;
+
+		const std::string failure = CheckFrame(frame, reader->Capacity(), seenFrame);
+		//Anything found wrong in a frame that was rewritten during the read says nothing about the writer
+		if (!reader->StillValid(frame)) {
+			stats.framesTorn++;
+			continue;
+		}
+		if (!failure.empty()) {
+			std::cout << "Frame " << frame.frame << " (sequence " << frame.sequence << "): " << failure << "\n";
+			stats.framesFailed++;
+		}
+		if (lastSequence != 0) stats.framesSkipped += frame.sequence - lastSequence - 1;
+		lastSequence = frame.sequence;
+		stats.framesRead++;
+
+		if (now - reportTime > std::chrono::seconds(1)) {
+			std::cout << "Frame " << frame.frame << ", " << frame.numStatics << " statics, " << frame.numDynamics << " dynamics, read " << stats.framesRead << " skipped "
+				<< stats.framesSkipped << " torn " << stats.framesTorn << " failed " << stats.framesFailed << "\n";
+			reportTime = now;
+		}
+	}
+
+	std::cout << "Read " << stats.framesRead << " frames, skipped " << stats.framesSkipped << ", torn " << stats.framesTorn << ", failed " << stats.framesFailed << "\n";
+	delete reader;
+	return stats.framesFailed == 0 ? 0 : 1;
+}